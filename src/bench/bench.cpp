@@ -8,6 +8,8 @@
 #include <test/setup_common.h>
 #include <validation.h>
 
+#include <univalue.h>
+
 #include <algorithm>
 #include <assert.h>
 #include <iomanip>
@@ -20,33 +22,77 @@ void benchmark::ConsolePrinter::header()
     std::cout << "# Benchmark, evals, iterations, total, min, max, median" << std::endl;
 }
 
-void benchmark::ConsolePrinter::result(const State& state)
+namespace {
+struct Summary {
+    double total = 0;
+    double min = 0;
+    double max = 0;
+    double median = 0;
+};
+
+Summary Summarize(const benchmark::State& state)
 {
     auto results = state.m_elapsed_results;
     std::sort(results.begin(), results.end());
 
-    double total = state.m_num_iters * std::accumulate(results.begin(), results.end(), 0.0);
-
-    double front = 0;
-    double back = 0;
-    double median = 0;
+    Summary summary;
+    summary.total = state.m_num_iters * std::accumulate(results.begin(), results.end(), 0.0);
 
     if (!results.empty()) {
-        front = results.front();
-        back = results.back();
+        summary.min = results.front();
+        summary.max = results.back();
 
         size_t mid = results.size() / 2;
-        median = results[mid];
+        summary.median = results[mid];
         if (0 == results.size() % 2) {
-            median = (results[mid] + results[mid + 1]) / 2;
+            summary.median = (results[mid - 1] + results[mid]) / 2;
         }
     }
+    return summary;
+}
+}
+
+void benchmark::ConsolePrinter::result(const State& state)
+{
+    const auto summary = Summarize(state);
 
     std::cout << std::setprecision(6);
-    std::cout << state.m_name << ", " << state.m_num_evals << ", " << state.m_num_iters << ", " << total << ", " << front << ", " << back << ", " << median << std::endl;
+    std::cout << state.m_name << ", " << state.m_num_evals << ", " << state.m_num_iters << ", " << summary.total << ", " << summary.min << ", " << summary.max << ", " << summary.median << std::endl;
 }
 
 void benchmark::ConsolePrinter::footer() {}
+
+void benchmark::JsonPrinter::header() {}
+
+void benchmark::JsonPrinter::result(const State& state)
+{
+    const auto summary = Summarize(state);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("name", state.m_name);
+    result.pushKV("evals", state.m_num_evals);
+    result.pushKV("iterations", state.m_num_iters);
+    result.pushKV("total", summary.total);
+    result.pushKV("min", summary.min);
+    result.pushKV("max", summary.max);
+    result.pushKV("median", summary.median);
+    UniValue elapsed(UniValue::VARR);
+    for (const auto& e : state.m_elapsed_results) {
+        elapsed.push_back(e);
+    }
+    result.pushKV("elapsed", elapsed);
+    m_results.push_back(result.write());
+}
+
+void benchmark::JsonPrinter::footer()
+{
+    // collected until the end so the output is a single JSON document
+    std::cout << "[";
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        std::cout << (i ? ",\n " : "") << m_results[i];
+    }
+    std::cout << "]" << std::endl;
+}
 benchmark::PlotlyPrinter::PlotlyPrinter(std::string plotly_url, int64_t width, int64_t height)
     : m_plotly_url(plotly_url), m_width(width), m_height(height)
 {
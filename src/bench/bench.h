@@ -116,6 +116,18 @@ public:
     void footer() override;
 };
 
+// machine readable results, one object per benchmark, times in seconds per iteration
+class JsonPrinter : public Printer
+{
+public:
+    void header() override;
+    void result(const State& state) override;
+    void footer() override;
+
+private:
+    std::vector<std::string> m_results;
+};
+
 // creates box plot with plotly.js
 class PlotlyPrinter : public Printer
 {
@@ -0,0 +1,65 @@
+// Copyright (c) DeFi Blockchain Developers
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <masternodes/masternodes.h>
+#include <validation.h>
+
+static const int BLOCK_TXS = 500;
+static const int TX_BALANCES = 4;
+static const uint32_t HEIGHT = 100;
+
+// Connects and disconnects a block of balance transfers, the undo being
+// written one record per tx or compacted into one record for the block
+static void CustomUndo(benchmark::State& state, bool compact)
+{
+    LOCK(cs_main);
+    CCustomCSView base(*pcustomcsview);
+
+    std::vector<uint256> txids;
+    std::vector<CScript> owners;
+    for (int i = 0; i < BLOCK_TXS; ++i) {
+        txids.push_back(uint256S(strprintf("%x", i + 1)));
+        owners.push_back(CScript() << OP_0 << ToByteVector(txids.back()));
+        for (int j = 0; j < TX_BALANCES; ++j) {
+            base.AddBalance(owners.back(), {DCT_ID{uint32_t(j)}, 100 * COIN});
+        }
+    }
+
+    while (state.KeepRunning()) {
+        CCustomCSView block(base);
+        for (int i = 0; i < BLOCK_TXS; ++i) {
+            CCustomCSView tx(block);
+            for (int j = 0; j < TX_BALANCES; ++j) {
+                tx.SubBalance(owners[i], {DCT_ID{uint32_t(j)}, COIN});
+                tx.AddBalance(owners[(i + 1) % BLOCK_TXS], {DCT_ID{uint32_t(j)}, COIN});
+            }
+            auto undo = CUndo::Construct(block.GetStorage(), tx.GetStorage().GetRaw());
+            tx.Flush();
+            block.SetUndo(UndoKey{HEIGHT, txids[i]}, undo);
+        }
+        if (compact) {
+            block.CompactBlockUndo(HEIGHT);
+        }
+
+        const auto blockUndo = block.GetBlockUndo(HEIGHT);
+        for (int i = BLOCK_TXS - 1; i >= 0; --i) {
+            block.OnUndoTx(txids[i], HEIGHT, blockUndo ? &*blockUndo : nullptr);
+        }
+        assert(block.GetBalance(owners[0], DCT_ID{0}).nValue == 100 * COIN);
+    }
+}
+
+static void CustomUndoPerTx(benchmark::State& state)
+{
+    CustomUndo(state, false);
+}
+
+static void CustomUndoPerBlock(benchmark::State& state)
+{
+    CustomUndo(state, true);
+}
+
+BENCHMARK(CustomUndoPerTx, 5);
+BENCHMARK(CustomUndoPerBlock, 5);
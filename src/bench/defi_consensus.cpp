@@ -0,0 +1,446 @@
+// Copyright (c) DeFi Blockchain Developers
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/merkle.h>
+#include <consensus/validation.h>
+#include <masternodes/accountshistory.h>
+#include <masternodes/masternodes.h>
+#include <masternodes/mn_checks.h>
+#include <masternodes/undo.h>
+#include <validation.h>
+
+static const int DEFI_TOKENS = 1000;
+static const int DEFI_LOAN_TOKENS = 20;
+static const int DEFI_PROVIDERS = 5000;
+static const int DEFI_POOLS_PER_PROVIDER = 4;
+static const int DEFI_ORACLES = 100;
+static const int DEFI_VAULTS = 10000;
+static const int DEFI_REWARD_HEIGHTS = 100;
+static const int DEFI_SWAPS_PER_HEIGHT = 20;
+static const int DEFI_BLOCK_TXS = 200;
+static const int64_t DEFI_TIME = 1600000000;
+
+namespace {
+
+// Synthetic mainnet shaped state on top of the regtest genesis: plain tokens paired with DFI,
+// LP providers spread over several pools with reward history, loan tokens priced by a set
+// of oracles and a vault population where a fraction took loans.
+// Everything the timed transactions have to authorize is owned by a single OP_TRUE actor,
+// spendable with an empty scriptSig, so no signing is involved.
+struct DeFiState
+{
+    CCustomCSView base;
+    CCoinsViewCache coins;
+    const CScript actor = CScript() << OP_TRUE;
+    const std::string schemeId = "BENCH";
+    std::vector<DCT_ID> tokens;
+    std::vector<DCT_ID> pools;
+    std::vector<DCT_ID> loanTokens;
+    std::vector<CScript> providers;
+    std::vector<COracleId> oracles;
+    CVaultId actorVault;
+    uint32_t height;
+    uint256 prevHash;
+    CBlockIndex prevIndex;
+    int createdTokens = 0;
+    int authCoins = 0;
+
+    DeFiState();
+
+    DCT_ID CreateToken(const std::string& symbol, uint8_t flags);
+    CMutableTransaction CreateAuthTx(const std::vector<unsigned char>& metadata);
+
+    template<typename T>
+    CMutableTransaction CreateTx(CustomTxType type, const T& msg)
+    {
+        CDataStream metadata(DfTxMarker, SER_NETWORK, PROTOCOL_VERSION);
+        metadata << static_cast<unsigned char>(type) << msg;
+        return CreateAuthTx(std::vector<unsigned char>(metadata.begin(), metadata.end()));
+    }
+
+    // One transaction of the given type, cycling through pools, providers and oracles by index
+    CMutableTransaction CreateTx(CustomTxType type, int i);
+};
+
+DeFiState::DeFiState() : base(*pcustomcsview), coins(&::ChainstateActive().CoinsTip())
+{
+    // all DeFi rules active, params are selected again for every benchmark
+    auto& consensus = const_cast<Consensus::Params&>(Params().GetConsensus());
+    consensus.AMKHeight = consensus.BayfrontHeight = consensus.BayfrontMarinaHeight = consensus.BayfrontGardensHeight = 0;
+    consensus.ClarkeQuayHeight = consensus.DakotaHeight = consensus.DakotaCrescentHeight = 0;
+    consensus.EunosHeight = consensus.EunosKampungHeight = consensus.EunosPayaHeight = 0;
+    consensus.FortCanningHeight = consensus.FortCanningMuseumHeight = consensus.FortCanningParkHeight = 0;
+    consensus.FortCanningHillHeight = consensus.FortCanningRoadHeight = 0;
+
+    // a height where both oracle and collateralization events are due
+    height = base.GetIntervalBlock() * consensus.blocksCollateralizationRatioCalculation();
+
+    const auto dat = (uint8_t)CToken::TokenFlags::Default | (uint8_t)CToken::TokenFlags::DAT;
+    CPoolPair pool{};
+    pool.idTokenB = DCT_ID{0};
+    pool.commission = COIN / 500;
+    pool.status = true;
+    for (int i = 0; i < DEFI_TOKENS; ++i) {
+        tokens.push_back(CreateToken(strprintf("T%d", i), (uint8_t)CToken::TokenFlags::Default));
+        pools.push_back(CreateToken(strprintf("P%d", i), (uint8_t)CToken::TokenFlags::Default | (uint8_t)CToken::TokenFlags::LPS));
+        pool.idTokenA = tokens.back();
+        assert(base.SetPoolPair(pools.back(), 1, pool));
+        assert(base.SetRewardPct(pools.back(), 1, COIN / DEFI_TOKENS));
+        assert(base.AddBalance(actor, {tokens.back(), 1000000 * COIN}));
+    }
+    assert(base.SetDailyReward(1, 10000 * COIN));
+    assert(base.AddBalance(actor, {DCT_ID{0}, 100000000 * COIN}));
+
+    std::vector<CPoolPair> reserves;
+    for (const auto& poolId : pools) {
+        reserves.push_back(*base.GetPoolPair(poolId));
+    }
+    for (int i = 0; i < DEFI_PROVIDERS; ++i) {
+        providers.push_back(CScript() << i << OP_DROP << OP_TRUE);
+        for (int j = 0; j < DEFI_POOLS_PER_PROVIDER; ++j) {
+            const auto index = (i * DEFI_POOLS_PER_PROVIDER + j) % DEFI_TOKENS;
+            assert(reserves[index].AddLiquidity(100 * COIN, 100 * COIN, [&](CAmount liqAmount) {
+                return base.AddBalance(providers.back(), {pools[index], liqAmount});
+            }, false));
+            assert(base.SetShare(pools[index], providers.back(), 1));
+        }
+    }
+    for (size_t i = 0; i < pools.size(); ++i) {
+        assert(base.SetPoolPair(pools[i], 1, reserves[i]));
+    }
+    // the actor provides liquidity to the first pool, for RemovePoolLiquidity
+    assert(base.AddBalance(actor, {pools[0], 1000 * COIN}));
+    assert(base.SetShare(pools[0], actor, 1));
+
+    // reward history, commissions from a few swaps per height
+    for (int h = 2; h <= DEFI_REWARD_HEIGHTS; ++h) {
+        for (int i = 0; i < DEFI_SWAPS_PER_HEIGHT; ++i) {
+            CPoolSwapMessage msg{actor, actor, tokens[(h * DEFI_SWAPS_PER_HEIGHT + i) % DEFI_TOKENS], DCT_ID{0}, COIN, POOLPRICE_MAX};
+            assert(CPoolSwap(msg, h).ExecuteSwap(base, {}));
+        }
+        base.UpdatePoolRewards([&](CScript const & owner, DCT_ID tokenID) {
+            return base.GetBalance(owner, tokenID);
+        }, [&](CScript const & from, CScript const & to, CTokenAmount amount) {
+            return !to.empty() ? base.AddBalance(to, amount) : Res::Ok();
+        }, h);
+    }
+
+    CLoanSchemeMessage scheme;
+    scheme.identifier = schemeId;
+    scheme.ratio = 150;
+    scheme.rate = COIN;
+    assert(base.StoreLoanScheme(scheme));
+    assert(base.StoreDefaultLoanScheme(schemeId));
+
+    CLoanSetCollateralTokenImplementation collateralToken;
+    collateralToken.idToken = DCT_ID{0};
+    collateralToken.factor = COIN;
+    collateralToken.fixedIntervalPriceId = {"DFI", "USD"};
+    collateralToken.creationTx = uint256S("c0");
+    assert(base.CreateLoanCollateralToken(collateralToken));
+
+    // loan tokens trade against DUSD and DUSD against DFI, the route paid interest is swapped along
+    std::set<CTokenCurrencyPair> pairs{{"DFI", "USD"}};
+    for (int i = 0; i < DEFI_LOAN_TOKENS; ++i) {
+        const auto symbol = i ? strprintf("L%d", i) : std::string("DUSD");
+        loanTokens.push_back(CreateToken(symbol, dat | (uint8_t)CToken::TokenFlags::LoanToken));
+        CLoanSetLoanTokenImplementation loanToken;
+        loanToken.symbol = symbol;
+        loanToken.fixedIntervalPriceId = {symbol, "USD"};
+        loanToken.mintable = true;
+        loanToken.creationTx = static_cast<CTokenImplementation&>(*base.GetToken(loanTokens.back())).creationTx;
+        assert(base.SetLoanToken(loanToken, loanTokens.back()));
+        assert(base.AddBalance(actor, {loanTokens.back(), 1000000 * COIN}));
+        pairs.insert(loanToken.fixedIntervalPriceId);
+
+        CPoolPair loanPool{pool};
+        loanPool.idTokenA = loanTokens.back();
+        loanPool.idTokenB = i ? loanTokens[0] : DCT_ID{0};
+        const auto loanPoolId = CreateToken(strprintf("LP%d", i), (uint8_t)CToken::TokenFlags::Default | (uint8_t)CToken::TokenFlags::LPS);
+        assert(base.SetPoolPair(loanPoolId, 1, loanPool));
+        assert(loanPool.AddLiquidity(100000 * COIN, 100000 * COIN, [&](CAmount liqAmount) {
+            return base.AddBalance(actor, {loanPoolId, liqAmount});
+        }, false));
+        assert(base.SetPoolPair(loanPoolId, 1, loanPool));
+    }
+
+    CTokenPrices prices;
+    for (const auto& pair : pairs) {
+        prices[pair.first][pair.second] = 2 * COIN;
+        CFixedIntervalPrice price{};
+        price.priceFeedId = pair;
+        price.timestamp = DEFI_TIME;
+        price.priceRecord[0] = price.priceRecord[1] = 2 * COIN;
+        assert(base.SetFixedIntervalPrice(price));
+    }
+    for (int i = 0; i < DEFI_ORACLES; ++i) {
+        COracle oracle;
+        oracle.oracleAddress = actor;
+        oracle.weightage = 1;
+        oracle.availablePairs = pairs;
+        oracles.push_back(uint256S(strprintf("20%x", i)));
+        assert(base.AppointOracle(oracles.back(), oracle));
+        assert(base.SetOracleData(oracles.back(), DEFI_TIME, prices));
+    }
+
+    CVaultData vault{};
+    vault.schemeId = schemeId;
+    for (int i = 0; i < DEFI_VAULTS; ++i) {
+        const auto vaultId = uint256S(strprintf("30%x", i));
+        vault.ownerAddress = i ? providers[i % DEFI_PROVIDERS] : actor;
+        if (!i) {
+            actorVault = vaultId;
+        }
+        assert(base.StoreVault(vaultId, vault));
+        assert(base.AddVaultCollateral(vaultId, {DCT_ID{0}, 1000 * COIN}));
+        if (i % 10 == 0) {
+            const auto loanId = loanTokens[i % DEFI_LOAN_TOKENS];
+            assert(base.AddLoanToken(vaultId, {loanId, 10 * COIN}));
+            assert(base.StoreInterest(1, vaultId, schemeId, loanId, 10 * COIN));
+        }
+    }
+
+    base.SetLastHeight(height - 1);
+    prevHash = uint256S("40");
+    prevIndex.phashBlock = &prevHash;
+    prevIndex.nHeight = height - 1;
+    prevIndex.nTime = DEFI_TIME;
+    coins.SetBestBlock(prevHash);
+}
+
+DCT_ID DeFiState::CreateToken(const std::string& symbol, uint8_t flags)
+{
+    CTokenImplementation token;
+    token.creationTx = uint256S(strprintf("%x", ++createdTokens));
+    token.symbol = symbol;
+    token.flags = flags;
+    // balances are credited directly, account for them as minted
+    token.minted = 100000000 * COIN;
+    auto res = base.CreateToken(token, false);
+    assert(res);
+    return *res.val;
+}
+
+CMutableTransaction DeFiState::CreateAuthTx(const std::vector<unsigned char>& metadata)
+{
+    // every transaction spends its own actor coin, so a block can carry any number of them
+    const COutPoint prevout(uint256S(strprintf("50%x", ++authCoins)), 0);
+    coins.AddCoin(prevout, Coin(CTxOut(COIN, actor), 1, false), false);
+
+    CMutableTransaction tx;
+    tx.vin.emplace_back(prevout);
+    tx.vout.emplace_back(0, CScript() << OP_RETURN << metadata);
+    tx.vout.emplace_back(COIN, actor);
+    return tx;
+}
+
+CMutableTransaction DeFiState::CreateTx(CustomTxType type, int i)
+{
+    const auto token = tokens[i % DEFI_TOKENS];
+    const auto loanToken = loanTokens[i % DEFI_LOAN_TOKENS];
+    switch (type) {
+        case CustomTxType::AccountToAccount:
+            return CreateTx(type, CAccountToAccountMessage{actor, {{providers[i % DEFI_PROVIDERS], CBalances{{{token, COIN}}}}}});
+        case CustomTxType::PoolSwap:
+            return CreateTx(type, CPoolSwapMessage{actor, actor, token, DCT_ID{0}, COIN, POOLPRICE_MAX});
+        case CustomTxType::AddPoolLiquidity:
+            return CreateTx(type, CLiquidityMessage{{{actor, CBalances{{{token, COIN}, {DCT_ID{0}, COIN}}}}}, actor});
+        case CustomTxType::RemovePoolLiquidity:
+            return CreateTx(type, CRemoveLiquidityMessage{actor, {pools[0], COIN}});
+        case CustomTxType::DepositToVault:
+            return CreateTx(type, CDepositToVaultMessage{actorVault, actor, {DCT_ID{0}, COIN}});
+        case CustomTxType::TakeLoan:
+            return CreateTx(type, CLoanTakeLoanMessage{actorVault, actor, CBalances{{{loanToken, COIN}}}});
+        case CustomTxType::PaybackLoan:
+            return CreateTx(type, CLoanPaybackLoanMessage{actorVault, actor, CBalances{{{loanTokens[0], COIN / 10}}}});
+        case CustomTxType::SetOracleData:
+            return CreateTx(type, CSetOracleDataMessage{oracles[i % DEFI_ORACLES], DEFI_TIME, {{base.GetToken(loanToken)->symbol, {{"USD", 2 * COIN}}}}});
+        default:
+            assert(false);
+            return {};
+    }
+}
+
+// The transaction mix of a DeFi heavy block
+static const std::vector<CustomTxType> blockTxTypes{
+    CustomTxType::PoolSwap,
+    CustomTxType::PoolSwap,
+    CustomTxType::PoolSwap,
+    CustomTxType::AccountToAccount,
+    CustomTxType::AddPoolLiquidity,
+    CustomTxType::RemovePoolLiquidity,
+    CustomTxType::SetOracleData,
+    CustomTxType::DepositToVault,
+    CustomTxType::TakeLoan,
+    CustomTxType::PaybackLoan,
+};
+
+} // namespace
+
+// One custom transaction through ApplyCustomTx, the full per transaction path of ConnectBlock
+// including its undo, on a fresh block layer every time
+static void DeFiApplyCustomTx(benchmark::State& state, CustomTxType type)
+{
+    LOCK(cs_main);
+    DeFiState defi;
+    const CTransaction tx(defi.CreateTx(type, 1));
+    const auto& consensus = Params().GetConsensus();
+
+    while (state.KeepRunning()) {
+        CCustomCSView block(defi.base);
+        auto res = ApplyCustomTx(block, defi.coins, tx, consensus, defi.height, DEFI_TIME);
+        assert(res);
+    }
+}
+
+static void DeFiApplyAccountToAccount(benchmark::State& state) { DeFiApplyCustomTx(state, CustomTxType::AccountToAccount); }
+static void DeFiApplyPoolSwap(benchmark::State& state) { DeFiApplyCustomTx(state, CustomTxType::PoolSwap); }
+static void DeFiApplyAddPoolLiquidity(benchmark::State& state) { DeFiApplyCustomTx(state, CustomTxType::AddPoolLiquidity); }
+static void DeFiApplyRemovePoolLiquidity(benchmark::State& state) { DeFiApplyCustomTx(state, CustomTxType::RemovePoolLiquidity); }
+static void DeFiApplyDepositToVault(benchmark::State& state) { DeFiApplyCustomTx(state, CustomTxType::DepositToVault); }
+static void DeFiApplyTakeLoan(benchmark::State& state) { DeFiApplyCustomTx(state, CustomTxType::TakeLoan); }
+static void DeFiApplyPaybackLoan(benchmark::State& state) { DeFiApplyCustomTx(state, CustomTxType::PaybackLoan); }
+static void DeFiApplySetOracleData(benchmark::State& state) { DeFiApplyCustomTx(state, CustomTxType::SetOracleData); }
+
+// Pending rewards of one provider over its pools and the whole reward history
+static void DeFiCalculateOwnerRewards(benchmark::State& state)
+{
+    LOCK(cs_main);
+    DeFiState defi;
+
+    int i = 0;
+    while (state.KeepRunning()) {
+        CCustomCSView view(defi.base);
+        assert(view.CalculateOwnerRewards(defi.providers[i++ % DEFI_PROVIDERS], defi.height));
+    }
+}
+
+static void DeFiUpdatePoolRewards(benchmark::State& state)
+{
+    LOCK(cs_main);
+    DeFiState defi;
+
+    while (state.KeepRunning()) {
+        CCustomCSView view(defi.base);
+        view.UpdatePoolRewards([&](CScript const & owner, DCT_ID tokenID) {
+            view.CalculateOwnerRewards(owner, defi.height);
+            return view.GetBalance(owner, tokenID);
+        }, [&](CScript const & from, CScript const & to, CTokenAmount amount) {
+            return !to.empty() ? view.AddBalance(to, amount) : Res::Ok();
+        }, defi.height);
+    }
+}
+
+// Collateralization sweep over every vault, the block where the ratios are due
+static void DeFiProcessLoanEvents(benchmark::State& state)
+{
+    LOCK(cs_main);
+    DeFiState defi;
+    CBlockIndex index;
+    index.pprev = &defi.prevIndex;
+    index.nHeight = defi.height;
+    index.nTime = DEFI_TIME;
+    // auctions flush the burn history, a node always has it open
+    pburnHistoryDB = MakeUnique<CBurnHistoryStorage>(GetDataDir() / "burn", 1 << 20, true);
+
+    while (state.KeepRunning()) {
+        CCustomCSView view(defi.base);
+        CChainState::ProcessLoanEvents(&index, view, Params());
+    }
+    pburnHistoryDB.reset();
+}
+
+// Aggregation of all oracle feeds into the fixed interval prices
+static void DeFiProcessOracleEvents(benchmark::State& state)
+{
+    LOCK(cs_main);
+    DeFiState defi;
+    CBlockIndex index;
+    index.pprev = &defi.prevIndex;
+    index.nHeight = defi.height;
+    index.nTime = DEFI_TIME;
+
+    while (state.KeepRunning()) {
+        CCustomCSView view(defi.base);
+        CChainState::ProcessOracleEvents(&index, view, Params());
+    }
+}
+
+// Undo of a whole block of DeFi transactions against the state below it
+static void DeFiUndoConstruct(benchmark::State& state)
+{
+    LOCK(cs_main);
+    DeFiState defi;
+    CCustomCSView block(defi.base);
+    CCustomCSView txs(block);
+    const auto& consensus = Params().GetConsensus();
+    for (int i = 0; i < DEFI_BLOCK_TXS; ++i) {
+        const CTransaction tx(defi.CreateTx(blockTxTypes[i % blockTxTypes.size()], i));
+        assert(ApplyCustomTx(txs, defi.coins, tx, consensus, defi.height, DEFI_TIME));
+    }
+
+    while (state.KeepRunning()) {
+        auto undo = CUndo::Construct(block.GetStorage(), txs.GetStorage().GetRaw());
+        assert(!undo.before.empty());
+    }
+}
+
+// ConnectBlock of a generated DeFi heavy block. Blocks are connected as in TestBlockValidity,
+// the path that needs neither a staker signature nor an indexed chain, which times the
+// transaction checks, scripts and ApplyCustomTx of every transaction and the coinbase.
+// Block level events are timed by the benchmarks above.
+static void DeFiConnectBlock(benchmark::State& state)
+{
+    LOCK(cs_main);
+    DeFiState defi;
+    const auto& consensus = Params().GetConsensus();
+
+    CBlock block;
+    block.nTime = DEFI_TIME;
+    block.hashPrevBlock = defi.prevHash;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << defi.height << OP_0;
+    const auto blockReward = GetBlockSubsidy(defi.height, consensus);
+    coinbase.vout.emplace_back(CalculateCoinbaseReward(blockReward, consensus.dist.masternode), defi.actor);
+    coinbase.vout.emplace_back(CalculateCoinbaseReward(blockReward, consensus.dist.community), consensus.foundationShareScript);
+    block.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+    for (int i = 0; i < DEFI_BLOCK_TXS; ++i) {
+        block.vtx.push_back(MakeTransactionRef(defi.CreateTx(blockTxTypes[i % blockTxTypes.size()], i)));
+    }
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+
+    const auto hash = block.GetHash();
+    CBlockIndex index(block);
+    index.pprev = &defi.prevIndex;
+    index.nHeight = defi.height;
+    index.phashBlock = &hash;
+
+    while (state.KeepRunning()) {
+        CValidationState validationState;
+        CCoinsViewCache view(&defi.coins);
+        CCustomCSView mnview(defi.base);
+        std::vector<uint256> rewardedAnchors;
+        assert(::ChainstateActive().ConnectBlock(block, validationState, &index, view, mnview, Params(), rewardedAnchors, true));
+    }
+}
+
+BENCHMARK(DeFiApplyAccountToAccount, 100);
+BENCHMARK(DeFiApplyPoolSwap, 100);
+BENCHMARK(DeFiApplyAddPoolLiquidity, 100);
+BENCHMARK(DeFiApplyRemovePoolLiquidity, 100);
+BENCHMARK(DeFiApplyDepositToVault, 100);
+BENCHMARK(DeFiApplyTakeLoan, 100);
+BENCHMARK(DeFiApplyPaybackLoan, 100);
+BENCHMARK(DeFiApplySetOracleData, 100);
+BENCHMARK(DeFiCalculateOwnerRewards, 100);
+BENCHMARK(DeFiUpdatePoolRewards, 1);
+BENCHMARK(DeFiProcessLoanEvents, 1);
+BENCHMARK(DeFiProcessOracleEvents, 1);
+BENCHMARK(DeFiUndoConstruct, 10);
+BENCHMARK(DeFiConnectBlock, 1);
@@ -0,0 +1,76 @@
+// Copyright (c) DeFi Blockchain Developers
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <masternodes/masternodes.h>
+#include <masternodes/mn_checks.h>
+#include <validation.h>
+
+static const int SWAP_ACCOUNTS = 200;
+static const int SWAPS_PER_BLOCK = 100;
+
+static DCT_ID CreateBenchToken(CCustomCSView& mnview, const std::string& symbol, uint8_t flags)
+{
+    static int counter = 0;
+    CTokenImplementation token;
+    token.creationTx = uint256S(strprintf("%x", ++counter));
+    token.symbol = symbol;
+    token.flags = flags;
+    auto res = mnview.CreateToken(token, false);
+    assert(res.ok);
+    return *res.val;
+}
+
+// Synthetic block of pool swaps executed through the same view stack as ConnectBlock:
+// one layer per block, one layer per transaction, nested layers inside ExecuteSwap
+static void PoolSwapViewStack(benchmark::State& state)
+{
+    LOCK(cs_main);
+    CCustomCSView base(*pcustomcsview);
+
+    auto idA = CreateBenchToken(base, "A", (uint8_t)CToken::TokenFlags::Default);
+    auto idB = CreateBenchToken(base, "B", (uint8_t)CToken::TokenFlags::Default);
+    auto idPool = CreateBenchToken(base, "A-B", (uint8_t)CToken::TokenFlags::Default | (uint8_t)CToken::TokenFlags::DAT | (uint8_t)CToken::TokenFlags::LPS);
+
+    CPoolPair pool{};
+    pool.idTokenA = idA;
+    pool.idTokenB = idB;
+    pool.commission = COIN / 100;
+    pool.status = true;
+    assert(base.SetPoolPair(idPool, 1, pool).ok);
+
+    auto optPool = base.GetPoolPair(idPool);
+    assert(optPool);
+    const CScript provider = CScript() << OP_TRUE;
+    assert(optPool->AddLiquidity(1000000 * COIN, 1000000 * COIN, [&](CAmount liqAmount) {
+        return base.AddBalance(provider, {idPool, liqAmount});
+    }, false).ok);
+    assert(base.SetPoolPair(idPool, 1, *optPool).ok);
+
+    std::vector<CScript> accounts;
+    for (int i = 0; i < SWAP_ACCOUNTS; ++i) {
+        accounts.push_back(CScript() << i << OP_DROP << OP_TRUE);
+        assert(base.AddBalance(accounts.back(), {idA, 1000 * COIN}).ok);
+        assert(base.AddBalance(accounts.back(), {idB, 1000 * COIN}).ok);
+    }
+
+    const uint32_t height = 100;
+    while (state.KeepRunning()) {
+        CCustomCSView block(base);
+        for (int i = 0; i < SWAPS_PER_BLOCK; ++i) {
+            CCustomCSView tx(block);
+            CPoolSwapMessage msg;
+            msg.from = msg.to = accounts[i % SWAP_ACCOUNTS];
+            msg.idTokenFrom = i % 2 ? idA : idB;
+            msg.idTokenTo = i % 2 ? idB : idA;
+            msg.amountFrom = COIN;
+            msg.maxPrice = POOLPRICE_MAX;
+            assert(CPoolSwap(msg, height).ExecuteSwap(tx, {}).ok);
+            tx.Flush();
+        }
+        block.MerkleRoot();
+    }
+}
+
+BENCHMARK(PoolSwapViewStack, 20);
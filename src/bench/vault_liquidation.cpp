@@ -0,0 +1,93 @@
+// Copyright (c) DeFi Blockchain Developers
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <masternodes/masternodes.h>
+#include <validation.h>
+
+#include <boost/thread.hpp>
+
+static const int VAULTS = 100000;
+static const int VAULTS_WITH_LOANS_RATIO = 10;
+
+// Collateralization sweep over a synthetic vault set where only a fraction
+// of the vaults took a loan, the common shape of mainnet vaults
+static void VaultLiquidationSweep(benchmark::State& state, CCheckQueue<CLiquidationCheck>* queue)
+{
+    LOCK(cs_main);
+    CCustomCSView base(*pcustomcsview);
+
+    const std::string schemeId("BENCH");
+    CLoanSchemeMessage scheme;
+    scheme.identifier = schemeId;
+    scheme.ratio = 150;
+    scheme.rate = COIN;
+    base.StoreLoanScheme(scheme);
+
+    CTokenImplementation token;
+    token.creationTx = uint256S("1");
+    token.symbol = "TSLA";
+    token.flags = (uint8_t)CToken::TokenFlags::Default | (uint8_t)CToken::TokenFlags::LoanToken | (uint8_t)CToken::TokenFlags::DAT;
+    auto res = base.CreateToken(token, false);
+    assert(res.ok);
+    const auto loanId = *res.val;
+
+    CLoanSetLoanTokenImplementation loanToken;
+    loanToken.symbol = token.symbol;
+    loanToken.fixedIntervalPriceId = {"TSLA", "USD"};
+    loanToken.creationTx = uint256S("2");
+    base.SetLoanToken(loanToken, loanId);
+
+    CLoanSetCollateralTokenImplementation collateralToken;
+    collateralToken.idToken = DCT_ID{0};
+    collateralToken.factor = COIN;
+    collateralToken.fixedIntervalPriceId = {"DFI", "USD"};
+    collateralToken.creationTx = uint256S("3");
+    base.CreateLoanCollateralToken(collateralToken);
+
+    CFixedIntervalPrice price{};
+    price.priceFeedId = {"TSLA", "USD"};
+    price.priceRecord[0] = price.priceRecord[1] = 3 * COIN;
+    assert(base.SetFixedIntervalPrice(price));
+    price.priceFeedId = {"DFI", "USD"};
+    price.priceRecord[0] = price.priceRecord[1] = 5 * COIN;
+    assert(base.SetFixedIntervalPrice(price));
+
+    CVaultData vault{};
+    vault.schemeId = schemeId;
+    for (int i = 0; i < VAULTS; ++i) {
+        auto vaultId = uint256S(strprintf("%x", i + 0x100));
+        assert(base.StoreVault(vaultId, vault));
+        assert(base.AddVaultCollateral(vaultId, {DCT_ID{0}, 10 * COIN}));
+        if (i % VAULTS_WITH_LOANS_RATIO == 0) {
+            assert(base.AddLoanToken(vaultId, {loanId, 10 * COIN}));
+            assert(base.StoreInterest(1, vaultId, schemeId, loanId, 10 * COIN));
+        }
+    }
+
+    while (state.KeepRunning()) {
+        auto candidates = base.GetLiquidationCandidates(100, 0, queue);
+        assert(candidates.empty());
+    }
+}
+
+static void VaultLiquidationSweepSerial(benchmark::State& state)
+{
+    VaultLiquidationSweep(state, nullptr);
+}
+
+static void VaultLiquidationSweepParallel(benchmark::State& state)
+{
+    CCheckQueue<CLiquidationCheck> queue(128);
+    boost::thread_group workers;
+    for (int i = 0; i < GetNumCores() - 1; ++i) {
+        workers.create_thread([&]() { queue.Thread(); });
+    }
+    VaultLiquidationSweep(state, &queue);
+    workers.interrupt_all();
+    workers.join_all();
+}
+
+BENCHMARK(VaultLiquidationSweepSerial, 1);
+BENCHMARK(VaultLiquidationSweepParallel, 1);
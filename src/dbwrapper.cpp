@@ -239,6 +239,23 @@ void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
 void CDBIterator::Next() { piter->Next(); }
 void CDBIterator::Prev() { piter->Prev(); }
 
+Span<const unsigned char> CDBIterator::GetValueBytes(std::vector<unsigned char>& buffer) const
+{
+    leveldb::Slice slValue = piter->value();
+    auto value = reinterpret_cast<const unsigned char*>(slValue.data());
+    const auto& key = dbwrapper_private::GetObfuscateKey(parent);
+    if (std::all_of(key.begin(), key.end(), [](unsigned char c) { return c == 0; })) {
+        return {value, static_cast<std::ptrdiff_t>(slValue.size())};
+    }
+    buffer.assign(value, value + slValue.size());
+    for (size_t i = 0, j = 0; i != buffer.size(); i++) {
+        buffer[i] ^= key[j++];
+        if (j == key.size())
+            j = 0;
+    }
+    return MakeSpan(buffer);
+}
+
 namespace dbwrapper_private {
 
 void HandleError(const leveldb::Status& status)
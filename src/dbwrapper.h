@@ -188,6 +188,16 @@ public:
         return piter->value().size();
     }
 
+    /** Raw key bytes, valid until the iterator is moved */
+    Span<const unsigned char> GetKeyBytes() const {
+        leveldb::Slice slKey = piter->key();
+        return {reinterpret_cast<const unsigned char*>(slKey.data()), static_cast<std::ptrdiff_t>(slKey.size())};
+    }
+
+    /** Raw value bytes, valid until the iterator is moved.
+     *  Obfuscated values are decoded into buffer, others are returned in place. */
+    Span<const unsigned char> GetValueBytes(std::vector<unsigned char>& buffer) const;
+
 };
 
 //template<>
@@ -10,11 +10,54 @@
 #include <optional.h>
 #include <map>
 #include <memusage.h>
+#include <prevector.h>
+#include <span.h>
+#include <support/allocators/node_arena.h>
+#include <sync.h>
 
 #include <boost/thread.hpp>
 
+#include <cstring>
+#include <memory>
+#include <typeinfo>
+
 using TBytes = std::vector<unsigned char>;
-using MapKV = std::map<TBytes, Optional<TBytes>>;
+// Non-owning view over key/value bytes, valid until the owning iterator moves
+using TBytesView = Span<const unsigned char>;
+
+// In-memory layers keep short keys and values inline, most records fit without extra heap allocations
+using TKeyBytes = prevector<40, unsigned char>;
+using TValueBytes = prevector<24, unsigned char>;
+
+template<typename A, typename B>
+inline int CompareBytes(const A& a, const B& b) {
+    const auto sizeA = size_t(a.size()), sizeB = size_t(b.size());
+    if (auto size = std::min(sizeA, sizeB)) {
+        if (auto cmp = std::memcmp(a.data(), b.data(), size)) {
+            return cmp;
+        }
+    }
+    return sizeA < sizeB ? -1 : sizeA > sizeB ? 1 : 0;
+}
+
+// Lexicographic byte order (same as std::vector<unsigned char>), usable across TBytes/TKeyBytes
+struct BytesLess {
+    using is_transparent = void;
+    template<typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        return CompareBytes(a, b) < 0;
+    }
+};
+
+struct BytesGreater {
+    using is_transparent = void;
+    template<typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        return CompareBytes(a, b) > 0;
+    }
+};
+
+using MapKV = std::map<TKeyBytes, Optional<TValueBytes>, BytesLess, node_arena_allocator<std::pair<const TKeyBytes, Optional<TValueBytes>>>>;
 
 template<typename T>
 static TBytes DbTypeToBytes(const T& value) {
@@ -25,7 +68,7 @@ static TBytes DbTypeToBytes(const T& value) {
 }
 
 template<typename T>
-static bool BytesToDbType(const TBytes& bytes, T& value) {
+static bool BytesToDbType(TBytesView bytes, T& value) {
     try {
         VectorReader stream(SER_DISK, CLIENT_VERSION, bytes, 0);
         stream >> value;
@@ -37,6 +80,11 @@ static bool BytesToDbType(const TBytes& bytes, T& value) {
     return true;
 }
 
+template<typename T>
+static bool BytesToDbType(const TBytes& bytes, T& value) {
+    return BytesToDbType(MakeSpan(bytes), value);
+}
+
 // Key-Value storage iterator interface
 class CStorageKVIterator {
 public:
@@ -45,8 +93,8 @@ public:
     virtual void Next() = 0;
     virtual void Prev() = 0;
     virtual bool Valid() = 0;
-    virtual TBytes Key() = 0;
-    virtual TBytes Value() = 0;
+    virtual TBytesView Key() = 0;
+    virtual TBytesView Value() = 0;
 };
 
 // Represents an empty iterator
@@ -57,8 +105,8 @@ public:
     void Next() override {}
     void Prev() override {}
     bool Valid() override { return false; }
-    TBytes Key() override { return {}; }
-    TBytes Value() override { return {}; }
+    TBytesView Key() override { return {}; }
+    TBytesView Value() override { return {}; }
 };
 
 // Key-Value storage interface
@@ -118,18 +166,15 @@ public:
     bool Valid() override {
         return it->Valid();
     }
-    TBytes Key() override {
-        TBytes key;
-        auto rawKey = refTBytes(key);
-        return it->GetKey(rawKey) ? key : TBytes{};
+    TBytesView Key() override {
+        return it->GetKeyBytes();
     }
-    TBytes Value() override {
-        TBytes value;
-        auto rawValue = refTBytes(value);
-        return it->GetValue(rawValue) ? value : TBytes{};
+    TBytesView Value() override {
+        return it->GetValueBytes(valueBuffer);
     }
 private:
     std::unique_ptr<CDBIterator> it;
+    TBytes valueBuffer; // only used by obfuscated databases
 };
 
 // LevelDB glue layer storage
@@ -182,31 +227,184 @@ private:
 
 // Flashable storage
 
+// Keys a layer read from the layers below it
+struct CStorageReadSet {
+    // key range walked by an iterator, both ends included, open runs to the end of the storage
+    struct Range {
+        TBytes begin;
+        TBytes end;
+        bool open;
+    };
+
+    std::set<TBytes> keys;
+    std::set<uint8_t> prefixes;
+    std::vector<Range> ranges;
+
+    // True when a write to any of the keys could change what was read
+    bool Conflicts(const std::set<TBytes>& written) const {
+        for (const auto& key : keys) {
+            if (written.count(key)) {
+                return true;
+            }
+        }
+        for (const auto prefix : prefixes) {
+            auto it = written.lower_bound(TBytes{prefix});
+            if (it != written.end() && !it->empty() && (*it)[0] == prefix) {
+                return true;
+            }
+        }
+        for (const auto& range : ranges) {
+            auto it = written.lower_bound(range.begin);
+            if (it != written.end() && (range.open || !std::lexicographical_compare(range.end.begin(), range.end.end(), it->begin(), it->end()))) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Decoded values of small, hot tables, kept by the storage layer they were read through.
+// Any change to a key in that layer drops its entry, the generation keeps reads racing
+// with a change from storing what they decoded before it.
+class CDecodedCache {
+public:
+    static constexpr size_t MAX_ENTRIES = 100000;
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t entries;
+    };
+
+    template<typename T>
+    bool Read(const CStorageKV& layer, const TBytes& key, T& value) {
+        uint64_t readGeneration;
+        {
+            LOCK(cs);
+            auto it = entries.find(key);
+            if (it != entries.end() && (!it->second.value || *it->second.type == typeid(T))) {
+                ++hits;
+                if (!it->second.value) {
+                    return false;
+                }
+                value = *static_cast<const T*>(it->second.value.get());
+                return true;
+            }
+            ++misses;
+            readGeneration = generation;
+        }
+
+        // absent keys are cached as well, as an entry without value
+        std::shared_ptr<T> decoded;
+        TBytes vValue;
+        if (layer.Read(key, vValue)) {
+            decoded = std::make_shared<T>();
+            if (!BytesToDbType(vValue, *decoded)) {
+                return false;
+            }
+        }
+        {
+            LOCK(cs);
+            if (readGeneration == generation) {
+                if (entries.size() >= MAX_ENTRIES) {
+                    entries.clear();
+                }
+                entries[key] = Entry{&typeid(T), decoded};
+            }
+        }
+        if (!decoded) {
+            return false;
+        }
+        value = *decoded;
+        return true;
+    }
+
+    template<typename Key>
+    void Invalidate(const Key& key) {
+        LOCK(cs);
+        ++generation;
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            entries.erase(it);
+        }
+    }
+
+    void Clear() {
+        LOCK(cs);
+        ++generation;
+        entries.clear();
+    }
+
+    Stats GetStats() const {
+        LOCK(cs);
+        return {hits, misses, entries.size()};
+    }
+
+private:
+    struct Entry {
+        const std::type_info* type;
+        std::shared_ptr<const void> value;
+    };
+
+    mutable Mutex cs;
+    std::map<TBytes, Entry, BytesLess> entries GUARDED_BY(cs);
+    uint64_t generation GUARDED_BY(cs){0};
+    uint64_t hits GUARDED_BY(cs){0};
+    uint64_t misses GUARDED_BY(cs){0};
+};
+
 // Flushable Key-Value Storage Iterator
 class CFlushableStorageKVIterator : public CStorageKVIterator {
 public:
-    explicit CFlushableStorageKVIterator(std::unique_ptr<CStorageKVIterator>&& pIt, MapKV& map) : map(map), pIt(std::move(pIt)) {
+    explicit CFlushableStorageKVIterator(std::unique_ptr<CStorageKVIterator>&& pIt, MapKV& map, CStorageReadSet* readSet = nullptr) : map(map), pIt(std::move(pIt)), readSet(readSet) {
         itState = Invalid;
     }
     CFlushableStorageKVIterator(const CFlushableStorageKVIterator&) = delete;
-    ~CFlushableStorageKVIterator() override = default;
+    ~CFlushableStorageKVIterator() override {
+        SaveRange();
+    }
 
     void Seek(const TBytes& key) override {
+        if (readSet) {
+            SaveRange();
+            range = CStorageReadSet::Range{key, key, false};
+        }
         pIt->Seek(key);
-        mIt = Advance(map.lower_bound(key), map.end(), std::greater<TBytes>{}, {});
+        prevKey.clear();
+        mIt = Advance(map.lower_bound(key), map.end(), BytesGreater{});
+        ExtendRange(true);
     }
     void Next() override {
         assert(Valid());
-        mIt = Advance(mIt, map.end(), std::greater<TBytes>{}, Key());
+        SavePrevKey();
+        mIt = Advance(mIt, map.end(), BytesGreater{});
+        ExtendRange(true);
     }
     void Prev() override {
         assert(Valid());
+        SavePrevKey();
+        PrevMap();
+        ExtendRange(false);
+    }
+    bool Valid() override {
+        return itState != Invalid;
+    }
+    TBytesView Key() override {
+        assert(Valid());
+        return itState == Map ? TBytesView(mIt->first.data(), mIt->first.size()) : pIt->Key();
+    }
+    TBytesView Value() override {
+        assert(Valid());
+        return itState == Map ? TBytesView(mIt->second->data(), mIt->second->size()) : pIt->Value();
+    }
+private:
+    void PrevMap() {
         auto tmp = mIt;
         if (tmp != map.end()) {
             ++tmp;
         }
         auto it = std::reverse_iterator<decltype(tmp)>(tmp);
-        auto end = Advance(it, map.rend(), std::less<TBytes>{}, Key());
+        auto end = Advance(it, map.rend(), BytesLess{});
         if (end == map.rend()) {
             mIt = map.begin();
         } else {
@@ -214,20 +412,39 @@ public:
             std::advance(mIt, -std::distance(it, end) - offset);
         }
     }
-    bool Valid() override {
-        return itState != Invalid;
+    // the walked range grows to the current key, past the last key it stays open
+    void ExtendRange(bool forward) {
+        if (!range) {
+            return;
+        }
+        if (!Valid()) {
+            if (forward) {
+                range->open = true;
+            } else {
+                range->begin.clear();
+            }
+            return;
+        }
+        auto key = Key();
+        if (forward && !range->open && std::lexicographical_compare(range->end.begin(), range->end.end(), key.begin(), key.end())) {
+            range->end.assign(key.begin(), key.end());
+        } else if (!forward && std::lexicographical_compare(key.begin(), key.end(), range->begin.begin(), range->begin.end())) {
+            range->begin.assign(key.begin(), key.end());
+        }
     }
-    TBytes Key() override {
-        assert(Valid());
-        return itState == Map ? mIt->first : pIt->Key();
+    void SaveRange() {
+        if (range) {
+            readSet->ranges.push_back(std::move(*range));
+            range.reset();
+        }
     }
-    TBytes Value() override {
-        assert(Valid());
-        return itState == Map ? *mIt->second : pIt->Value();
+    // current key has to outlive the move of the parent iterator
+    void SavePrevKey() {
+        auto key = Key();
+        prevKey.assign(key.begin(), key.end());
     }
-private:
     template<typename TIterator, typename Compare>
-    TIterator Advance(TIterator it, TIterator end, Compare comp, TBytes prevKey) {
+    TIterator Advance(TIterator it, TIterator end, Compare comp) {
 
         while (it != end || pIt->Valid()) {
             while (it != end && (!pIt->Valid() || !comp(it->first, pIt->Key()))) {
@@ -236,7 +453,7 @@ private:
                         itState = Map;
                         return it;
                     } else {
-                        prevKey = it->first;
+                        prevKey.assign(it->first.begin(), it->first.end());
                     }
                 }
                 ++it;
@@ -261,13 +478,16 @@ private:
     const MapKV& map;
     MapKV::const_iterator mIt;
     std::unique_ptr<CStorageKVIterator> pIt;
+    CStorageReadSet* readSet;
+    Optional<CStorageReadSet::Range> range;
+    TBytes prevKey;
     enum IteratorState { Invalid, Map, Parent } itState;
 };
 
 // Flushable Key-Value Storage
 class CFlushableStorageKV : public CStorageKV {
 public:
-    explicit CFlushableStorageKV(CStorageKV& db_) : db(db_) {}
+    explicit CFlushableStorageKV(CStorageKV& db_) : db(db_), changed(MapKV::allocator_type{&arena}) {}
     CFlushableStorageKV(const CFlushableStorageKV&) = delete;
     ~CFlushableStorageKV() override = default;
 
@@ -276,57 +496,123 @@ public:
         if (it != changed.end()) {
             return bool(it->second);
         }
+        if (readSet) {
+            readSet->keys.insert(key);
+        }
         return db.Exists(key);
     }
     bool Write(const TBytes& key, const TBytes& value) override {
-        changed[key] = value;
+        Set(key, TValueBytes(value.begin(), value.end()));
         return true;
     }
     bool Erase(const TBytes& key) override {
-        changed[key] = {};
+        Set(key, {});
         return true;
     }
     bool Read(const TBytes& key, TBytes& value) const override {
         auto it = changed.find(key);
         if (it == changed.end()) {
+            if (readSet) {
+                readSet->keys.insert(key);
+            }
             return db.Read(key, value);
         } else if (it->second) {
-            value = it->second.get();
+            value.assign(it->second->begin(), it->second->end());
             return true;
         } else {
             return false;
         }
     }
     bool Flush() override {
-        for (const auto& it : changed) {
-            if (!it.second) {
-                if (!db.Erase(it.first)) {
+        // nested layers merge map to map, without a round trip through TBytes
+        if (auto parent = dynamic_cast<CFlushableStorageKV*>(&db)) {
+            for (auto& it : changed) {
+                parent->Set(it.first, std::move(it.second));
+            }
+        } else {
+            for (const auto& it : changed) {
+                if (!it.second) {
+                    if (!db.Erase(TBytes(it.first.begin(), it.first.end()))) {
+                        return false;
+                    }
+                } else if (!db.Write(TBytes(it.first.begin(), it.first.end()), TBytes(it.second->begin(), it.second->end()))) {
                     return false;
                 }
-            } else if (!db.Write(it.first, it.second.get())) {
-                return false;
             }
         }
-        changed.clear();
+        Clear();
         return true;
     }
     void Discard() override {
-        changed.clear();
+        Clear();
+        if (decoded) {
+            decoded->Clear();
+        }
     }
     size_t SizeEstimate() const override {
-        return memusage::DynamicUsage(changed);
+        return memusage::MallocUsage(sizeof(memusage::stl_tree_node<MapKV::value_type>)) * changed.size();
     }
     std::unique_ptr<CStorageKVIterator> NewIterator() override {
-        return MakeUnique<CFlushableStorageKVIterator>(db.NewIterator(), changed);
+        return MakeUnique<CFlushableStorageKVIterator>(db.NewIterator(), changed, readSet);
     }
 
     MapKV& GetRaw() {
         return changed;
     }
 
+    // Records reads that miss this layer into readSet, nullptr stops recording
+    void TrackReads(CStorageReadSet* set) {
+        readSet = set;
+    }
+    CStorageReadSet* GetReadSet() const {
+        return readSet;
+    }
+
+    // Keeps decoded values read through this layer, see CStorageView::ReadCachedBy
+    void EnableDecodedCache() {
+        decoded = MakeUnique<CDecodedCache>();
+    }
+    CDecodedCache* GetDecodedCache() const {
+        return decoded.get();
+    }
+
+    CStorageKV& GetParent() const {
+        return db;
+    }
+    // True when this layer holds the key, records the miss into readSet otherwise
+    bool Holds(const TBytes& key) const {
+        if (changed.find(key) != changed.end()) {
+            return true;
+        }
+        if (readSet) {
+            readSet->keys.insert(key);
+        }
+        return false;
+    }
+
 private:
+    template<typename Key>
+    void Set(const Key& key, Optional<TValueBytes>&& value) {
+        if (decoded) {
+            decoded->Invalidate(key);
+        }
+        auto it = changed.lower_bound(key);
+        if (it != changed.end() && !changed.key_comp()(key, it->first)) {
+            it->second = std::move(value);
+        } else {
+            changed.emplace_hint(it, TKeyBytes(key.begin(), key.end()), std::move(value));
+        }
+    }
+    void Clear() {
+        changed.clear();
+        arena.Clear();
+    }
+
     CStorageKV& db;
+    CNodeArena arena;
     MapKV changed;
+    CStorageReadSet* readSet{nullptr};
+    std::unique_ptr<CDecodedCache> decoded;
 };
 
 template<typename T>
@@ -361,7 +647,13 @@ class CStorageIteratorWrapper {
     std::unique_ptr<CStorageKVIterator> it;
 
     void UpdateValidity() {
-        valid = it->Valid() && BytesToDbType(it->Key(), key) && key.first == By::prefix();
+        if (!it->Valid()) {
+            valid = false;
+            return;
+        }
+        // check prefix before paying for key deserialization
+        auto rawKey = it->Key();
+        valid = rawKey.size() > 0 && rawKey[0] == By::prefix() && BytesToDbType(rawKey, key);
     }
 
     struct Resolver {
@@ -480,6 +772,30 @@ public:
     bool ReadBy(const KeyType& key, ValueType& value) const {
         return Read(std::make_pair(By::prefix(), key), value);
     }
+    // Same as ReadBy, served from the decoded cache of the nearest layer keeping one
+    // unless a layer above it holds the key. Meant for small tables read many times per block.
+    template<typename By, typename KeyType, typename ValueType>
+    bool ReadCachedBy(const KeyType& key, ValueType& value) const {
+        auto vKey = DbTypeToBytes(std::make_pair(By::prefix(), key));
+        auto layer = dynamic_cast<const CFlushableStorageKV*>(&DB());
+        for (; layer; layer = dynamic_cast<const CFlushableStorageKV*>(&layer->GetParent())) {
+            if (auto cache = layer->GetDecodedCache()) {
+                return cache->Read(*layer, vKey, value);
+            }
+            if (layer->Holds(vKey)) {
+                break;
+            }
+        }
+        TBytes vValue;
+        return DB().Read(vKey, vValue) && BytesToDbType(vValue, value);
+    }
+    template<typename By, typename ResultType, typename KeyType>
+    boost::optional<ResultType> ReadCachedBy(KeyType const & id) const {
+        ResultType result;
+        if (ReadCachedBy<By>(id, result))
+            return {result};
+        return {};
+    }
     // second type of 'ReadBy' (may be 'GetBy'?)
     template<typename By, typename ResultType, typename KeyType>
     boost::optional<ResultType> ReadBy(KeyType const & id) const {
@@ -410,6 +410,7 @@ void SetupServerArgs()
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-customundodepth=<n>", strprintf("Keep undo data of the custom chain state for the last <n> blocks only, pruning older data a few blocks at a time and compacting the database in the background (default: 0 = prune at checkpoints only, >=%u = number of blocks to keep)", MIN_BLOCKS_TO_KEEP), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #ifndef WIN32
@@ -418,7 +419,9 @@ void SetupServerArgs()
     hidden_args.emplace_back("-sysperms");
 #endif
     gArgs.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-acfilterindex", strprintf("Maintain token and transaction type indexes of the account history, used by the token and txtype filters of listaccounthistory and accounthistorycount with no_rewards (default: %u)", DEFAULT_ACFILTERINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-acindex", strprintf("Maintain a full account history index, tracking all accounts balances changes. Used by the listaccounthistory, getaccounthistory and accounthistorycount rpc calls (default: %u)", DEFAULT_ACINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-rewardindex", strprintf("Record pool rewards of every owner as they are settled, so listaccounthistory and accounthistorycount of a single owner do not replay its history. Requires -acindex, history before enabling needs -reindex (default: %u)", DEFAULT_REWARDINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-vaultindex", strprintf("Maintain a full vault history index, tracking all vault changes. Used by the listvaulthistory rpc call (default: %u)", DEFAULT_VAULTINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockfilterindex=<type>",
                  strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
@@ -1142,6 +1145,15 @@ bool AppInitParameterInteraction()
         fPruneMode = true;
     }
 
+    const int64_t nCustomUndoDepthArg = gArgs.GetArg("-customundodepth", 0);
+    if (nCustomUndoDepthArg < 0 || (nCustomUndoDepthArg > 0 && nCustomUndoDepthArg < MIN_BLOCKS_TO_KEEP) || nCustomUndoDepthArg > std::numeric_limits<uint32_t>::max()) {
+        return InitError(strprintf(_("Custom undo depth must be 0 or at least %d blocks.").translated, MIN_BLOCKS_TO_KEEP));
+    }
+    nCustomUndoDepth = nCustomUndoDepthArg;
+    if (nCustomUndoDepth) {
+        LogPrintf("Custom undo data kept for the last %u blocks.\n", nCustomUndoDepth);
+    }
+
     nConnectTimeout = gArgs.GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0) {
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1337,6 +1349,14 @@ bool AppInitMain(InitInterfaces& interfaces)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread([i]() { return ThreadScriptCheck(i); });
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread([i]() { return ThreadLiquidationCheck(i); });
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread([i]() { return ThreadCustomTxCheck(i); });
+    }
+
+    if (nCustomUndoDepth) {
+        threadGroup.create_thread(std::bind(&TraceThread<void (*)()>, "undocompact", &ThreadCustomUndoCompaction));
     }
 
     // Start the lightweight task scheduler thread
@@ -1617,6 +1637,7 @@ bool AppInitMain(InitInterfaces& interfaces)
                 pcustomcsDB = MakeUnique<CStorageLevelDB>(GetDataDir() / "enhancedcs", nCustomCacheSize, false, fReset || fReindexChainState);
                 pcustomcsview.reset();
                 pcustomcsview = MakeUnique<CCustomCSView>(*pcustomcsDB.get());
+                pcustomcsview->GetStorage().EnableDecodedCache();
                 if (!fReset && !fReindexChainState) {
                     if (!pcustomcsDB->IsEmpty() && pcustomcsview->GetDbVersion() != CCustomCSView::DbVersion) {
                         strLoadError = _("Account database is unsuitable").translated;
@@ -1626,15 +1647,20 @@ bool AppInitMain(InitInterfaces& interfaces)
 
                 // Ensure we are on latest DB version
                 pcustomcsview->SetDbVersion(CCustomCSView::DbVersion);
+                pcustomcsview->InitOraclePairIndex();
+                pcustomcsview->InitVaultIndexes();
 
                 // make account history db
                 paccountHistoryDB.reset();
                 if (gArgs.GetBoolArg("-acindex", DEFAULT_ACINDEX)) {
                     paccountHistoryDB = MakeUnique<CAccountHistoryStorage>(GetDataDir() / "history", nCustomCacheSize, false, fReset || fReindexChainState);
+                    paccountHistoryDB->InitHistoryIndexes(gArgs.GetBoolArg("-acfilterindex", DEFAULT_ACFILTERINDEX));
+                    paccountHistoryDB->InitRewardHistory(gArgs.GetBoolArg("-rewardindex", DEFAULT_REWARDINDEX));
                 }
 
                 pburnHistoryDB.reset();
                 pburnHistoryDB = MakeUnique<CBurnHistoryStorage>(GetDataDir() / "burn", nCustomCacheSize, false, fReset || fReindexChainState);
+                pburnHistoryDB->InitBurnTotals();
 
                 // Create vault history DB
                 pvaultHistoryDB.reset();
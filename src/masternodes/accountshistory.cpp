@@ -5,6 +5,7 @@
 #include <masternodes/accountshistory.h>
 #include <masternodes/accounts.h>
 #include <masternodes/masternodes.h>
+#include <masternodes/mn_checks.h>
 #include <masternodes/vaulthistory.h>
 #include <key_io.h>
 
@@ -35,9 +36,414 @@ CAccountHistoryStorage::CAccountHistoryStorage(const fs::path& dbName, std::size
 {
 }
 
+Res CAccountHistoryStorage::WriteAccountHistory(const AccountHistoryKey& key, const AccountHistoryValue& value)
+{
+    if (historyIndexes) {
+        for (const auto& diff : value.diff) {
+            WriteBy<ByTokenHistoryKey>(AccountHistoryTokenKey{diff.first, key}, true);
+        }
+        WriteBy<ByTypeHistoryKey>(AccountHistoryTypeKey{value.category, key}, true);
+    }
+    return CAccountsHistoryView::WriteAccountHistory(key, value);
+}
+
+Res CAccountHistoryStorage::EraseAccountHistory(const AccountHistoryKey& key)
+{
+    if (historyIndexes) {
+        if (auto value = ReadAccountHistory(key)) {
+            for (const auto& diff : value->diff) {
+                EraseBy<ByTokenHistoryKey>(AccountHistoryTokenKey{diff.first, key});
+            }
+            EraseBy<ByTypeHistoryKey>(AccountHistoryTypeKey{value->category, key});
+        }
+    }
+    return CAccountsHistoryView::EraseAccountHistory(key);
+}
+
+void CAccountHistoryStorage::InitHistoryIndexes(bool enable)
+{
+    historyIndexes = enable;
+    if (enable == Exists(ByHistoryIndexes::prefix())) {
+        return;
+    }
+
+    if (enable) {
+        LogPrintf("Building account history indexes...\n");
+        ForEachAccountHistory([&](AccountHistoryKey const & key, CLazySerialize<AccountHistoryValue> valueLazy) {
+            const auto& value = valueLazy.get();
+            for (const auto& diff : value.diff) {
+                WriteBy<ByTokenHistoryKey>(AccountHistoryTokenKey{diff.first, key}, true);
+            }
+            WriteBy<ByTypeHistoryKey>(AccountHistoryTypeKey{value.category, key}, true);
+            return true;
+        });
+        Write(ByHistoryIndexes::prefix(), true);
+    } else {
+        // indexes are not maintained from now on, drop them so they are rebuilt when enabled again
+        std::vector<AccountHistoryTokenKey> tokenKeys;
+        ForEach<ByTokenHistoryKey, AccountHistoryTokenKey, bool>([&](AccountHistoryTokenKey const & key, CLazySerialize<bool>) {
+            tokenKeys.push_back(key);
+            return true;
+        });
+        for (const auto& key : tokenKeys) {
+            EraseBy<ByTokenHistoryKey>(key);
+        }
+        std::vector<AccountHistoryTypeKey> typeKeys;
+        ForEach<ByTypeHistoryKey, AccountHistoryTypeKey, bool>([&](AccountHistoryTypeKey const & key, CLazySerialize<bool>) {
+            typeKeys.push_back(key);
+            return true;
+        });
+        for (const auto& key : typeKeys) {
+            EraseBy<ByTypeHistoryKey>(key);
+        }
+        Erase(ByHistoryIndexes::prefix());
+    }
+    Flush();
+}
+
+template<typename By, typename IndexKey>
+void CAccountHistoryStorage::ForEachIndexedHistory(IndexKey const & start, std::function<bool(IndexKey const &)> const & match,
+                                                   std::function<bool(AccountHistoryKey const &, CLazySerialize<AccountHistoryValue>)> const & callback)
+{
+    auto historyIt = LowerBound<ByAccountHistoryKey>(start.key);
+    for (auto it = LowerBound<By>(start); it.Valid() && match(it.Key()); it.Next()) {
+        boost::this_thread::interruption_point();
+
+        const auto& key = it.Key().key;
+        historyIt.Seek(key);
+        if (!historyIt.Valid() || historyIt.Key().owner != key.owner
+        || historyIt.Key().blockHeight != key.blockHeight || historyIt.Key().txn != key.txn) {
+            continue;
+        }
+        if (!callback(historyIt.Key(), historyIt.Value())) {
+            break;
+        }
+    }
+}
+
+void CAccountHistoryStorage::ForEachAccountHistoryByToken(DCT_ID token, std::function<bool(AccountHistoryKey const &, CLazySerialize<AccountHistoryValue>)> callback, AccountHistoryKey const & start)
+{
+    ForEachIndexedHistory<ByTokenHistoryKey, AccountHistoryTokenKey>({token, start}, [&](AccountHistoryTokenKey const & key) {
+        return key.token == token;
+    }, callback);
+}
+
+void CAccountHistoryStorage::ForEachAccountHistoryByType(uint8_t category, std::function<bool(AccountHistoryKey const &, CLazySerialize<AccountHistoryValue>)> callback, AccountHistoryKey const & start)
+{
+    ForEachIndexedHistory<ByTypeHistoryKey, AccountHistoryTypeKey>({category, start}, [&](AccountHistoryTypeKey const & key) {
+        return key.category == category;
+    }, callback);
+}
+
+void CAccountHistoryStorage::WriteRewardHistory(RewardHistoryKey const & key, RewardHistoryValue const & value)
+{
+    WriteBy<ByRewardHistoryKey>(key, value);
+}
+
+void CAccountHistoryStorage::EraseRewardHistory(CScript const & owner, uint32_t height)
+{
+    std::vector<RewardHistoryKey> keys;
+    ForEachRewardHistory([&](RewardHistoryKey const & key, CLazySerialize<RewardHistoryValue>) {
+        if (key.owner != owner || key.blockHeight != height) {
+            return false;
+        }
+        keys.push_back(key);
+        return true;
+    }, {owner, height, DCT_ID{0}});
+
+    for (const auto& key : keys) {
+        EraseBy<ByRewardHistoryKey>(key);
+    }
+}
+
+void CAccountHistoryStorage::ForEachRewardHistory(std::function<bool(RewardHistoryKey const &, CLazySerialize<RewardHistoryValue>)> callback, RewardHistoryKey const & start)
+{
+    ForEach<ByRewardHistoryKey, RewardHistoryKey, RewardHistoryValue>(callback, start);
+}
+
+Optional<uint32_t> CAccountHistoryStorage::GetRewardHistoryStart() const
+{
+    uint32_t height;
+    if (rewardHistory && Read(ByRewardHistoryStart::prefix(), height)) {
+        return height;
+    }
+    return {};
+}
+
+void CAccountHistoryStorage::SetRewardHistoryStart(uint32_t height)
+{
+    Write(ByRewardHistoryStart::prefix(), height);
+}
+
+void CAccountHistoryStorage::InitRewardHistory(bool enable)
+{
+    rewardHistory = enable;
+    if (enable || !Exists(ByRewardHistoryStart::prefix())) {
+        return;
+    }
+
+    // history is not recorded from now on, a later enable starts over
+    std::vector<RewardHistoryKey> keys;
+    ForEachRewardHistory([&](RewardHistoryKey const & key, CLazySerialize<RewardHistoryValue>) {
+        keys.push_back(key);
+        return true;
+    });
+    for (const auto& key : keys) {
+        EraseBy<ByRewardHistoryKey>(key);
+    }
+    Erase(ByRewardHistoryStart::prefix());
+    Flush();
+}
+
+// owners whose balances height was changed
+static std::vector<std::pair<CScript, Optional<uint32_t>>> ChangedBalancesHeights(MapKV const & changes)
+{
+    std::vector<std::pair<CScript, Optional<uint32_t>>> owners;
+    const auto prefix = CAccountsView::ByHeightKey::prefix();
+    const auto end = changes.lower_bound(TBytes{uint8_t(prefix + 1)});
+    for (auto it = changes.lower_bound(TBytes{prefix}); it != end; ++it) {
+        std::pair<uint8_t, CScript> key;
+        if (!BytesToDbType(TBytes(it->first.begin(), it->first.end()), key)) {
+            continue;
+        }
+        Optional<uint32_t> height;
+        uint32_t value;
+        if (it->second && BytesToDbType(TBytes(it->second->begin(), it->second->end()), value)) {
+            height = value;
+        }
+        owners.emplace_back(std::move(key.second), height);
+    }
+    return owners;
+}
+
+void WriteBlockRewardHistory(CAccountHistoryStorage& historyView, CCustomCSView& view, MapKV const & changes, uint32_t height)
+{
+    if (!historyView.GetRewardHistoryStart()) {
+        historyView.SetRewardHistoryStart(height);
+    }
+
+    for (const auto& owner : ChangedBalancesHeights(changes)) {
+        if (!owner.second) {
+            continue;
+        }
+        // settle again on top of the state before the block, the result is thrown away
+        std::map<DCT_ID, RewardHistoryValue> pools;
+        CCustomCSView rewardsView(view);
+        rewardsView.CalculateOwnerRewards(owner.first, *owner.second, [&](DCT_ID poolId, RewardType type, CTokenAmount amount, uint32_t begin, uint32_t end) {
+            if (amount.nValue != 0) {
+                pools[poolId].push_back({uint8_t(type), amount, begin, end});
+            }
+        });
+        for (const auto& pool : pools) {
+            historyView.WriteRewardHistory({owner.first, *owner.second, pool.first}, pool.second);
+        }
+    }
+}
+
+void EraseBlockRewardHistory(CAccountHistoryStorage& historyView, MapKV const & changes, uint32_t height)
+{
+    for (const auto& owner : ChangedBalancesHeights(changes)) {
+        historyView.EraseRewardHistory(owner.first, height);
+    }
+}
+
+static void ApplyBurnAmounts(TAmounts& amounts, TAmounts const & diff, int sign)
+{
+    for (const auto& kv : diff) {
+        auto& amount = amounts[kv.first];
+        amount += sign * kv.second;
+        if (amount == 0) {
+            amounts.erase(kv.first);
+        }
+    }
+}
+
+void CBurnTotals::Apply(AccountHistoryValue const & value, int sign)
+{
+    auto sum = [&](CAmount& total) {
+        for (const auto& diff : value.diff) {
+            total += sign * diff.second;
+        }
+    };
+    // negative token diffs are never counted as burnt
+    auto sumTokens = [&](TAmounts& total) {
+        TAmounts positive;
+        for (const auto& diff : value.diff) {
+            if (diff.second > 0) {
+                positive.emplace(diff);
+            }
+        }
+        ApplyBurnAmounts(total, positive, sign);
+    };
+
+    switch (CustomTxType(value.category)) {
+        // UTXO burn
+        case CustomTxType::None:
+            sum(utxoBurn);
+            break;
+        // Fee burn
+        case CustomTxType::CreateMasternode:
+        case CustomTxType::CreateToken:
+        case CustomTxType::Vault:
+            sum(feeBurn);
+            break;
+        // withdraw burn
+        case CustomTxType::PaybackLoan:
+            sum(paybackBurn);
+            break;
+        // auction burn
+        case CustomTxType::AuctionBid:
+            sum(auctionBurn);
+            break;
+        // dex fee burn, split into loan and regular tokens on read
+        case CustomTxType::PoolSwap:
+        case CustomTxType::PoolSwapV2:
+            sumTokens(dexFeeBurn);
+            break;
+        // Token burn
+        default:
+            sumTokens(tokenBurn);
+            break;
+    }
+}
+
+void CBurnTotals::Apply(CBurnTotals const & other, int sign)
+{
+    utxoBurn += sign * other.utxoBurn;
+    feeBurn += sign * other.feeBurn;
+    auctionBurn += sign * other.auctionBurn;
+    paybackBurn += sign * other.paybackBurn;
+    ApplyBurnAmounts(dexFeeBurn, other.dexFeeBurn, sign);
+    ApplyBurnAmounts(tokenBurn, other.tokenBurn, sign);
+}
+
 CBurnHistoryStorage::CBurnHistoryStorage(const fs::path& dbName, std::size_t cacheSize, bool fMemory, bool fWipe)
-    : CStorageView(new CStorageLevelDB(dbName, cacheSize, fMemory, fWipe))
+    : CStorageView(new CStorageLevelDB(dbName, cacheSize, fMemory, fWipe)), totalsView(new CFlushableStorageKV(DB()))
+{
+}
+
+CBurnTotals CBurnHistoryStorage::ReadTotals(uint32_t height) const
+{
+    CBurnTotals totals;
+    totalsView.ReadBy<ByBurnHeight>(BurnHeightKey{height}, totals);
+    return totals;
+}
+
+void CBurnHistoryStorage::ApplyTotals(uint32_t height, CBurnTotals const & delta, int sign)
+{
+    const auto checkpoint = height - height % BURN_TOTALS_CHECKPOINT_INTERVAL;
+    if (sign > 0) {
+        // first write in the interval snapshots everything below it
+        if (checkpoint > 0 && !totalsView.ExistsBy<ByBurnCheckpoint>(BurnHeightKey{checkpoint})) {
+            auto totals = GetBurnTotals();
+            for (auto it = totalsView.LowerBound<ByBurnHeight>(BurnHeightKey{std::numeric_limits<uint32_t>::max()}); it.Valid() && it.Key().height >= checkpoint; it.Next()) {
+                totals.Apply(it.Value().as<CBurnTotals>(), -1);
+            }
+            totalsView.WriteBy<ByBurnCheckpoint>(BurnHeightKey{checkpoint}, totals);
+        }
+    } else {
+        // checkpoints above height contain the removed entry
+        std::vector<BurnHeightKey> staleCheckpoints;
+        for (auto it = totalsView.LowerBound<ByBurnCheckpoint>(BurnHeightKey{std::numeric_limits<uint32_t>::max()}); it.Valid() && it.Key().height > height; it.Next()) {
+            staleCheckpoints.push_back(it.Key());
+        }
+        for (const auto& key : staleCheckpoints) {
+            totalsView.EraseBy<ByBurnCheckpoint>(key);
+        }
+    }
+
+    auto totals = GetBurnTotals();
+    totals.Apply(delta, sign);
+    totalsView.Write(ByBurnTotals::prefix(), totals);
+
+    auto heightTotals = ReadTotals(height);
+    heightTotals.Apply(delta, sign);
+    totalsView.WriteBy<ByBurnHeight>(BurnHeightKey{height}, heightTotals);
+}
+
+Res CBurnHistoryStorage::WriteAccountHistory(const AccountHistoryKey& key, const AccountHistoryValue& value)
+{
+    CBurnTotals delta;
+    if (auto prev = ReadAccountHistory(key)) {
+        delta.Apply(*prev, -1);
+    }
+    delta.Apply(value, 1);
+    ApplyTotals(key.blockHeight, delta, 1);
+    return CAccountsHistoryView::WriteAccountHistory(key, value);
+}
+
+Res CBurnHistoryStorage::EraseAccountHistory(const AccountHistoryKey& key)
+{
+    if (auto prev = ReadAccountHistory(key)) {
+        CBurnTotals delta;
+        delta.Apply(*prev, 1);
+        ApplyTotals(key.blockHeight, delta, -1);
+    }
+    return CAccountsHistoryView::EraseAccountHistory(key);
+}
+
+CBurnTotals CBurnHistoryStorage::GetBurnTotals() const
+{
+    CBurnTotals totals;
+    totalsView.Read(ByBurnTotals::prefix(), totals);
+    return totals;
+}
+
+CBurnTotals CBurnHistoryStorage::GetBurnTotals(uint32_t height)
+{
+    CBurnTotals totals;
+    uint32_t checkpoint = 0;
+    auto it = totalsView.LowerBound<ByBurnCheckpoint>(BurnHeightKey{height});
+    if (it.Valid()) {
+        checkpoint = it.Key().height;
+        totals = it.Value().as<CBurnTotals>();
+    }
+    for (auto it = totalsView.LowerBound<ByBurnHeight>(BurnHeightKey{height}); it.Valid() && it.Key().height >= checkpoint; it.Next()) {
+        totals.Apply(it.Value().as<CBurnTotals>(), 1);
+    }
+    return totals;
+}
+
+void CBurnHistoryStorage::InitBurnTotals()
+{
+    if (totalsView.Exists(ByBurnTotals::prefix())) {
+        return;
+    }
+
+    CBurnTotals totals;
+    std::map<uint32_t, CBurnTotals> heights;
+    AccountHistoryKey startKey{{}, std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max()};
+    ForEachAccountHistory([&](AccountHistoryKey const & key, CLazySerialize<AccountHistoryValue> valueLazy) {
+        const auto& value = valueLazy.get();
+        totals.Apply(value, 1);
+        heights[key.blockHeight].Apply(value, 1);
+        return true;
+    }, startKey);
+
+    CBurnTotals running;
+    uint32_t lastCheckpoint = 0;
+    for (const auto& item : heights) {
+        const auto checkpoint = item.first - item.first % BURN_TOTALS_CHECKPOINT_INTERVAL;
+        if (checkpoint > lastCheckpoint) {
+            totalsView.WriteBy<ByBurnCheckpoint>(BurnHeightKey{checkpoint}, running);
+            lastCheckpoint = checkpoint;
+        }
+        running.Apply(item.second, 1);
+        totalsView.WriteBy<ByBurnHeight>(BurnHeightKey{item.first}, item.second);
+    }
+    totalsView.Write(ByBurnTotals::prefix(), totals);
+    Flush();
+}
+
+bool CBurnHistoryStorage::Flush()
+{
+    return totalsView.Flush() && CStorageView::Flush();
+}
+
+void CBurnHistoryStorage::Discard()
 {
+    totalsView.Discard();
+    CStorageView::Discard();
 }
 
 CAccountsHistoryWriter::CAccountsHistoryWriter(CCustomCSView & storage, uint32_t height, uint32_t txn, const uint256& txid, uint8_t type,
@@ -186,6 +592,10 @@ void CHistoryWriters::SubBalance(const CScript& owner, const CTokenAmount amount
 
 void CHistoryWriters::Flush(const uint32_t height, const uint256& txid, const uint32_t txn, const uint8_t type, const uint256& vaultID)
 {
+    if (held) {
+        heldFlush = HeldFlush{height, txid, txn, type, vaultID};
+        return;
+    }
     if (historyView) {
         for (const auto& diff : diffs) {
             historyView->WriteAccountHistory({diff.first, height, txn}, {txid, type, diff.second});
@@ -211,5 +621,19 @@ void CHistoryWriters::Flush(const uint32_t height, const uint256& txid, const ui
     }
 }
 
+void CHistoryWriters::Hold()
+{
+    held = true;
+}
+
+void CHistoryWriters::Release()
+{
+    held = false;
+    if (heldFlush) {
+        Flush(heldFlush->height, heldFlush->txid, heldFlush->txn, heldFlush->type, heldFlush->vaultID);
+        heldFlush.reset();
+    }
+}
+
 std::unique_ptr<CAccountHistoryStorage> paccountHistoryDB;
 std::unique_ptr<CBurnHistoryStorage> pburnHistoryDB;
@@ -41,6 +41,33 @@ struct AccountHistoryKey {
     }
 };
 
+// secondary index keys, ordered as the main history within the token or category
+struct AccountHistoryTokenKey {
+    DCT_ID token;
+    AccountHistoryKey key;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(WrapBigEndian(token.v));
+        READWRITE(key);
+    }
+};
+
+struct AccountHistoryTypeKey {
+    uint8_t category;
+    AccountHistoryKey key;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(category);
+        READWRITE(key);
+    }
+};
+
 struct AccountHistoryValue {
     uint256 txid;
     unsigned char category;
@@ -56,12 +83,100 @@ struct AccountHistoryValue {
     }
 };
 
+struct RewardHistoryKey {
+    CScript owner;
+    uint32_t blockHeight; // balances height the rewards were settled at
+    DCT_ID poolID;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(owner);
+
+        if (ser_action.ForRead()) {
+            READWRITE(WrapBigEndian(blockHeight));
+            blockHeight = ~blockHeight;
+        }
+        else {
+            uint32_t blockHeight_ = ~blockHeight;
+            READWRITE(WrapBigEndian(blockHeight_));
+        }
+        READWRITE(WrapBigEndian(poolID.v));
+    }
+};
+
+// the same amount is rewarded at every height of [begin, end)
+struct RewardHistoryRange {
+    uint8_t type;
+    CTokenAmount amount;
+    uint32_t begin;
+    uint32_t end;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(type);
+        READWRITE(amount);
+        READWRITE(begin);
+        READWRITE(end);
+    }
+};
+
+using RewardHistoryValue = std::vector<RewardHistoryRange>;
+
+struct BurnHeightKey {
+    uint32_t height;
+
+    ADD_SERIALIZE_METHODS;
+
+    // descending order, same as history keys
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        if (ser_action.ForRead()) {
+            READWRITE(WrapBigEndian(height));
+            height = ~height;
+        }
+        else {
+            uint32_t height_ = ~height;
+            READWRITE(WrapBigEndian(height_));
+        }
+    }
+};
+
+struct CBurnTotals {
+    CAmount utxoBurn{0};
+    CAmount feeBurn{0};
+    CAmount auctionBurn{0};
+    CAmount paybackBurn{0};
+    TAmounts dexFeeBurn;
+    TAmounts tokenBurn;
+
+    // adds (sign > 0) or removes (sign < 0) history entry contribution
+    void Apply(AccountHistoryValue const & value, int sign);
+    void Apply(CBurnTotals const & other, int sign);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(utxoBurn);
+        READWRITE(feeBurn);
+        READWRITE(auctionBurn);
+        READWRITE(paybackBurn);
+        READWRITE(dexFeeBurn);
+        READWRITE(tokenBurn);
+    }
+};
+
 class CAccountsHistoryView : public virtual CStorageView
 {
 public:
-    Res WriteAccountHistory(AccountHistoryKey const & key, AccountHistoryValue const & value);
+    virtual ~CAccountsHistoryView() = default;
+    virtual Res WriteAccountHistory(AccountHistoryKey const & key, AccountHistoryValue const & value);
     boost::optional<AccountHistoryValue> ReadAccountHistory(AccountHistoryKey const & key) const;
-    Res EraseAccountHistory(AccountHistoryKey const & key);
+    virtual Res EraseAccountHistory(AccountHistoryKey const & key);
     void ForEachAccountHistory(std::function<bool(AccountHistoryKey const &, CLazySerialize<AccountHistoryValue>)> callback, AccountHistoryKey const & start = {});
 
     // tags
@@ -71,14 +186,82 @@ public:
 class CAccountHistoryStorage : public CAccountsHistoryView
                              , public CAuctionHistoryView
 {
+    bool historyIndexes{false};
+    bool rewardHistory{false};
+
+    template<typename By, typename IndexKey>
+    void ForEachIndexedHistory(IndexKey const & start, std::function<bool(IndexKey const &)> const & match,
+                               std::function<bool(AccountHistoryKey const &, CLazySerialize<AccountHistoryValue>)> const & callback);
+
 public:
     CAccountHistoryStorage(const fs::path& dbName, std::size_t cacheSize, bool fMemory = false, bool fWipe = false);
+
+    Res WriteAccountHistory(AccountHistoryKey const & key, AccountHistoryValue const & value) override;
+    Res EraseAccountHistory(AccountHistoryKey const & key) override;
+
+    // builds token and category indexes from existing history or drops them when disabled
+    void InitHistoryIndexes(bool enable);
+    bool HasHistoryIndexes() const { return historyIndexes; }
+
+    // history entries touching the token or of the category, the index may hold stale
+    // entries so callers still have to check the value against their filter
+    void ForEachAccountHistoryByToken(DCT_ID token, std::function<bool(AccountHistoryKey const &, CLazySerialize<AccountHistoryValue>)> callback, AccountHistoryKey const & start = {});
+    void ForEachAccountHistoryByType(uint8_t category, std::function<bool(AccountHistoryKey const &, CLazySerialize<AccountHistoryValue>)> callback, AccountHistoryKey const & start = {});
+
+    void WriteRewardHistory(RewardHistoryKey const & key, RewardHistoryValue const & value);
+    void EraseRewardHistory(CScript const & owner, uint32_t height);
+    void ForEachRewardHistory(std::function<bool(RewardHistoryKey const &, CLazySerialize<RewardHistoryValue>)> callback, RewardHistoryKey const & start = {});
+
+    // reward history is complete for every settlement at or above the returned height
+    Optional<uint32_t> GetRewardHistoryStart() const;
+    void SetRewardHistoryStart(uint32_t height);
+    // drops reward history when disabled
+    void InitRewardHistory(bool enable);
+    bool HasRewardHistory() const { return rewardHistory; }
+
+    // tags
+    struct ByTokenHistoryKey { static constexpr uint8_t prefix() { return 't'; } };
+    struct ByTypeHistoryKey { static constexpr uint8_t prefix() { return 'y'; } };
+    struct ByHistoryIndexes { static constexpr uint8_t prefix() { return 'x'; } };
+    struct ByRewardHistoryKey { static constexpr uint8_t prefix() { return 'r'; } };
+    struct ByRewardHistoryStart { static constexpr uint8_t prefix() { return 'R'; } };
 };
 
+// Records the reward ranges settled by a connected block. view is the state before the block,
+// changes are the raw changes of the block on top of it.
+void WriteBlockRewardHistory(CAccountHistoryStorage& historyView, CCustomCSView& view, MapKV const & changes, uint32_t height);
+// Removes the reward ranges of a disconnected block, changes are the raw changes of the disconnect
+void EraseBlockRewardHistory(CAccountHistoryStorage& historyView, MapKV const & changes, uint32_t height);
+
 class CBurnHistoryStorage : public CAccountsHistoryView
 {
+    // burn totals, per height deltas and checkpoints are staged here
+    // so repeated updates within one batch read back their own writes
+    CStorageView totalsView;
+
+    CBurnTotals ReadTotals(uint32_t height) const;
+    void ApplyTotals(uint32_t height, CBurnTotals const & delta, int sign);
+
 public:
     CBurnHistoryStorage(const fs::path& dbName, std::size_t cacheSize, bool fMemory = false, bool fWipe = false);
+
+    Res WriteAccountHistory(AccountHistoryKey const & key, AccountHistoryValue const & value) override;
+    Res EraseAccountHistory(AccountHistoryKey const & key) override;
+
+    // totals of the whole burn history
+    CBurnTotals GetBurnTotals() const;
+    // totals of burn history up to and including height
+    CBurnTotals GetBurnTotals(uint32_t height);
+    // builds totals from existing history when missing
+    void InitBurnTotals();
+
+    bool Flush();
+    void Discard();
+
+    // tags
+    struct ByBurnTotals { static constexpr uint8_t prefix() { return 'T'; } };
+    struct ByBurnHeight { static constexpr uint8_t prefix() { return 'D'; } };
+    struct ByBurnCheckpoint { static constexpr uint8_t prefix() { return 'C'; } };
 };
 
 class CHistoryWriters {
@@ -88,6 +271,16 @@ class CHistoryWriters {
     std::map<CScript, TAmounts> burnDiffs;
     std::map<uint256, std::map<CScript,TAmounts>> vaultDiffs;
 
+    struct HeldFlush {
+        uint32_t height;
+        uint256 txid;
+        uint32_t txn;
+        uint8_t type;
+        uint256 vaultID;
+    };
+    bool held{false};
+    Optional<HeldFlush> heldFlush;
+
 public:
     CVaultHistoryStorage* vaultView;
     CLoanSchemeCreation globalLoanScheme;
@@ -99,6 +292,10 @@ public:
     void AddFeeBurn(const CScript& owner, const CAmount amount);
     void SubBalance(const CScript& owner, const CTokenAmount amount, const uint256& vaultID);
     void Flush(const uint32_t height, const uint256& txid, const uint32_t txn, const uint8_t type, const uint256& vaultID);
+    // Flush only records its arguments until Release writes the entries,
+    // for custom txs applied ahead of their turn in the block
+    void Hold();
+    void Release();
 };
 
 class CHistoryErasers {
@@ -157,5 +354,8 @@ extern std::unique_ptr<CAccountHistoryStorage> paccountHistoryDB;
 extern std::unique_ptr<CBurnHistoryStorage> pburnHistoryDB;
 
 static constexpr bool DEFAULT_ACINDEX = true;
+static constexpr bool DEFAULT_ACFILTERINDEX = true;
+static constexpr bool DEFAULT_REWARDINDEX = false;
+static constexpr uint32_t BURN_TOTALS_CHECKPOINT_INTERVAL = 2880;
 
 #endif //DEFI_MASTERNODES_ACCOUNTSHISTORY_H
@@ -83,8 +83,8 @@ void CGovView::EraseStoredVariables(const uint32_t height)
 }
 
 std::shared_ptr<ATTRIBUTES> CGovView::GetAttributes() const {
-    if (const auto var = GetVariable("ATTRIBUTES")) {
-        return std::dynamic_pointer_cast<ATTRIBUTES>(var);
-    }
-    return {};
+    // stored as the bare attributes map, which is what gets cached
+    auto attributes = std::make_shared<ATTRIBUTES>();
+    ReadCachedBy<ByName>(std::string(ATTRIBUTES::TypeName()), attributes->attributes);
+    return attributes;
 }
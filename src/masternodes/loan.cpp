@@ -65,7 +65,7 @@ std::unique_ptr<CLoanView::CLoanSetLoanTokenImpl> CLoanView::GetLoanToken(uint25
 
 std::unique_ptr<CLoanView::CLoanSetLoanTokenImpl> CLoanView::GetLoanTokenByID(DCT_ID const & id) const
 {
-    auto loanToken = ReadBy<LoanSetLoanTokenKey,CLoanSetLoanTokenImpl>(id);
+    auto loanToken = ReadCachedBy<LoanSetLoanTokenKey, CLoanSetLoanTokenImpl>(id);
     if (loanToken)
         return MakeUnique<CLoanSetLoanTokenImpl>(*loanToken);
     return {};
@@ -156,7 +156,7 @@ boost::optional<std::string> CLoanView::GetDefaultLoanScheme()
 
 boost::optional<CLoanSchemeData> CLoanView::GetLoanScheme(const std::string& loanSchemeID)
 {
-    return ReadBy<LoanSchemeKey, CLoanSchemeData>(loanSchemeID);
+    return ReadCachedBy<LoanSchemeKey, CLoanSchemeData>(loanSchemeID);
 }
 
 boost::optional<uint64_t> CLoanView::GetDestroyLoanScheme(const std::string& loanSchemeID)
@@ -8,6 +8,9 @@
 
 #include <chainparams.h>
 #include <consensus/merkle.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <hash.h>
 #include <net_processing.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
@@ -736,6 +739,21 @@ void CCustomCSView::SetDbVersion(int version)
     Write(DbVersion::prefix(), version);
 }
 
+// operators of the lowest priority hashes, only the team sized head gets sorted
+static CTeamView::CTeam SelectTeam(std::vector<std::pair<arith_uint256, CKeyID>>& priorityMN, int teamSize)
+{
+    const auto head = priorityMN.begin() + std::min<size_t>(std::max(teamSize, 0), priorityMN.size());
+    std::partial_sort(priorityMN.begin(), head, priorityMN.end(), [](const std::pair<arith_uint256, CKeyID>& a, const std::pair<arith_uint256, CKeyID>& b) {
+        return a.first < b.first;
+    });
+
+    CTeamView::CTeam team;
+    for (auto it = priorityMN.begin(); it != head; ++it) {
+        team.insert(it->second);
+    }
+    return team;
+}
+
 CTeamView::CTeam CCustomCSView::CalcNextTeam(int height, const uint256 & stakeModifier)
 {
     if (stakeModifier == uint256())
@@ -743,23 +761,30 @@ CTeamView::CTeam CCustomCSView::CalcNextTeam(int height, const uint256 & stakeMo
 
     int anchoringTeamSize = Params().GetConsensus().mn.anchoringTeamSize;
 
-    std::map<arith_uint256, CKeyID, std::less<arith_uint256>> priorityMN;
+    // node id and stake modifier make exactly one 64 byte block, hashed by the multi-lane SHA256 backends
+    std::vector<unsigned char> blocks;
+    std::vector<CKeyID> operators;
     ForEachMasternode([&] (uint256 const & id, CMasternode node) {
         if(!node.IsActive(height))
             return true;
 
-        CDataStream ss{SER_GETHASH, PROTOCOL_VERSION};
-        ss << id << stakeModifier;
-        priorityMN.insert(std::make_pair(UintToArith256(Hash(ss.begin(), ss.end())), node.operatorAuthAddress));
+        blocks.insert(blocks.end(), id.begin(), id.end());
+        blocks.insert(blocks.end(), stakeModifier.begin(), stakeModifier.end());
+        operators.push_back(node.operatorAuthAddress);
         return true;
     });
 
-    CTeam newTeam;
-    auto && it = priorityMN.begin();
-    for (int i = 0; i < anchoringTeamSize && it != priorityMN.end(); ++i, ++it) {
-        newTeam.insert(it->second);
+    std::vector<uint256> hashes(operators.size());
+    if (!hashes.empty()) {
+        SHA256D64(hashes[0].begin(), blocks.data(), hashes.size());
     }
-    return newTeam;
+
+    std::vector<std::pair<arith_uint256, CKeyID>> priorityMN;
+    priorityMN.reserve(hashes.size());
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        priorityMN.emplace_back(UintToArith256(hashes[i]), operators[i]);
+    }
+    return SelectTeam(priorityMN, anchoringTeamSize);
 }
 
 enum AnchorTeams {
@@ -767,6 +792,50 @@ enum AnchorTeams {
     ConfirmTeam
 };
 
+// Minted block counts per operator over the sample window ending at the tip, moved along with the tip
+static uint256 recentMintersTip GUARDED_BY(cs_main);
+static int recentMintersHeight GUARDED_BY(cs_main) = -1;
+static std::map<CKeyID, int> recentMinters GUARDED_BY(cs_main);
+
+static void UpdateRecentMinters(const CBlockIndex* pindex, int blockSample) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const auto previousTip = recentMintersHeight >= 0 ? pindex->GetAncestor(recentMintersHeight) : nullptr;
+    if (previousTip && previousTip->GetBlockHash() == recentMintersTip
+    && pindex->nHeight - recentMintersHeight < blockSample) {
+        for (auto block = pindex; block != previousTip; block = block->pprev) {
+            ++recentMinters[block->minterKey()];
+        }
+        // blocks below the window of the new tip
+        const int oldBegin = std::max(0, recentMintersHeight - blockSample + 1);
+        const int newBegin = std::max(0, pindex->nHeight - blockSample + 1);
+        if (newBegin > oldBegin) {
+            for (auto block = pindex->GetAncestor(newBegin - 1); block && block->nHeight >= oldBegin; block = block->pprev) {
+                auto it = recentMinters.find(block->minterKey());
+                if (it != recentMinters.end() && --it->second == 0) {
+                    recentMinters.erase(it);
+                }
+            }
+        }
+    } else {
+        recentMinters.clear();
+        const CBlockIndex* block = pindex;
+        for (int i{0}; block && i < blockSample; block = block->pprev, ++i) {
+            ++recentMinters[block->minterKey()];
+        }
+    }
+    recentMintersTip = pindex->GetBlockHash();
+    recentMintersHeight = pindex->nHeight;
+}
+
+static arith_uint256 AnchorTeamPriority(uint256 const & id, uint256 const & stakeModifier, AnchorTeams team)
+{
+    unsigned char teamBytes[4];
+    WriteLE32(teamBytes, static_cast<int>(team));
+    uint256 hash;
+    CHash256().Write(id.begin(), id.size()).Write(stakeModifier.begin(), stakeModifier.size()).Write(teamBytes, sizeof(teamBytes)).Finalize(hash.begin());
+    return UintToArith256(hash);
+}
+
 void CCustomCSView::CalcAnchoringTeams(const uint256 & stakeModifier, const CBlockIndex *pindexNew)
 {
     std::set<uint256> masternodeIDs;
@@ -774,49 +843,29 @@ void CCustomCSView::CalcAnchoringTeams(const uint256 & stakeModifier, const CBlo
 
     {
         LOCK(cs_main);
-        const CBlockIndex* pindex = pindexNew;
-        for (int i{0}; pindex && i < blockSample; pindex = pindex->pprev, ++i) {
-            if (auto id = GetMasternodeIdByOperator(pindex->minterKey())) {
+        UpdateRecentMinters(pindexNew, blockSample);
+        for (const auto& minter : recentMinters) {
+            if (auto id = GetMasternodeIdByOperator(minter.first)) {
                 masternodeIDs.insert(*id);
             }
         }
     }
 
-    std::map<arith_uint256, CKeyID, std::less<arith_uint256>> authMN;
-    std::map<arith_uint256, CKeyID, std::less<arith_uint256>> confirmMN;
-    ForEachMasternode([&] (uint256 const & id, CMasternode node) {
-        if(!node.IsActive(pindexNew->nHeight))
-            return true;
-
-        // Not in our list of MNs from last week, skip.
-        if (masternodeIDs.find(id) == masternodeIDs.end()) {
-            return true;
+    std::vector<std::pair<arith_uint256, CKeyID>> authMN;
+    std::vector<std::pair<arith_uint256, CKeyID>> confirmMN;
+    for (const auto& id : masternodeIDs) {
+        auto node = GetMasternode(id);
+        if (!node || !node->IsActive(pindexNew->nHeight)) {
+            continue;
         }
-
-        CDataStream authStream{SER_GETHASH, PROTOCOL_VERSION};
-        authStream << id << stakeModifier << static_cast<int>(AnchorTeams::AuthTeam);
-        authMN.insert(std::make_pair(UintToArith256(Hash(authStream.begin(), authStream.end())), node.operatorAuthAddress));
-
-        CDataStream confirmStream{SER_GETHASH, PROTOCOL_VERSION};
-        confirmStream << id << stakeModifier << static_cast<int>(AnchorTeams::ConfirmTeam);
-        confirmMN.insert(std::make_pair(UintToArith256(Hash(confirmStream.begin(), confirmStream.end())), node.operatorAuthAddress));
-
-        return true;
-    });
+        authMN.emplace_back(AnchorTeamPriority(id, stakeModifier, AnchorTeams::AuthTeam), node->operatorAuthAddress);
+        confirmMN.emplace_back(AnchorTeamPriority(id, stakeModifier, AnchorTeams::ConfirmTeam), node->operatorAuthAddress);
+    }
 
     int anchoringTeamSize = Params().GetConsensus().mn.anchoringTeamSize;
 
-    CTeam authTeam;
-    auto && it = authMN.begin();
-    for (int i = 0; i < anchoringTeamSize && it != authMN.end(); ++i, ++it) {
-        authTeam.insert(it->second);
-    }
-
-    CTeam confirmTeam;
-    it = confirmMN.begin();
-    for (int i = 0; i < anchoringTeamSize && it != confirmMN.end(); ++i, ++it) {
-        confirmTeam.insert(it->second);
-    }
+    CTeam authTeam = SelectTeam(authMN, anchoringTeamSize);
+    CTeam confirmTeam = SelectTeam(confirmMN, anchoringTeamSize);
 
     {
         LOCK(cs_main);
@@ -847,8 +896,15 @@ void CCustomCSView::CreateAndRelayConfirmMessageIfNeed(const CAnchorIndex::Ancho
     }
 }
 
-void CCustomCSView::OnUndoTx(uint256 const & txid, uint32_t height)
+void CCustomCSView::OnUndoTx(uint256 const & txid, uint32_t height, CBlockCustomUndo const * blockUndo)
 {
+    if (blockUndo) {
+        auto it = blockUndo->txs.find(txid);
+        if (it != blockUndo->txs.end()) {
+            CUndo::Revert(GetStorage(), it->second);
+            return;
+        }
+    }
     const auto undo = GetUndo(UndoKey{height, txid});
     if (!undo) {
         return; // not custom tx, or no changes done
@@ -857,6 +913,26 @@ void CCustomCSView::OnUndoTx(uint256 const & txid, uint32_t height)
     DelUndo(UndoKey{height, txid}); // erase undo data, it served its purpose
 }
 
+void CCustomCSView::CompactBlockUndo(uint32_t height)
+{
+    auto& raw = GetStorage().GetRaw();
+    auto it = raw.lower_bound(DbTypeToBytes(std::make_pair(ByUndoKey::prefix(), UndoKey{height, uint256()})));
+    const auto end = raw.lower_bound(DbTypeToBytes(std::make_pair(ByUndoKey::prefix(), UndoKey{height + 1, uint256()})));
+
+    CBlockCustomUndo blockUndo;
+    while (it != end) {
+        if (it->second) {
+            std::pair<uint8_t, UndoKey> key;
+            BytesToDbType(TBytes(it->first.begin(), it->first.end()), key);
+            BytesToDbType(TBytes(it->second->begin(), it->second->end()), blockUndo.txs[key.second.txid]);
+        }
+        it = raw.erase(it);
+    }
+    if (!blockUndo.txs.empty()) {
+        SetBlockUndo(height, blockUndo);
+    }
+}
+
 bool CCustomCSView::CanSpend(const uint256 & txId, int height) const
 {
     auto node = GetMasternode(txId);
@@ -871,7 +947,7 @@ bool CCustomCSView::CanSpend(const uint256 & txId, int height) const
     return !pair || pair->second.destructionTx != uint256{} || pair->second.IsPoolShare();
 }
 
-bool CCustomCSView::CalculateOwnerRewards(CScript const & owner, uint32_t targetHeight)
+bool CCustomCSView::CalculateOwnerRewards(CScript const & owner, uint32_t targetHeight, std::function<void(DCT_ID, RewardType, CTokenAmount, uint32_t, uint32_t)> onReward)
 {
     auto balanceHeight = GetBalancesHeight(owner);
     if (balanceHeight >= targetHeight) {
@@ -886,8 +962,23 @@ bool CCustomCSView::CalculateOwnerRewards(CScript const & owner, uint32_t target
             return GetBalance(owner, poolId).nValue;
         };
         auto beginHeight = std::max(*height, balanceHeight);
-        CalculatePoolRewards(poolId, onLiquidity, beginHeight, targetHeight,
-            [&](RewardType, CTokenAmount amount, uint32_t height) {
+        CalculatePoolRewardRanges(poolId, onLiquidity, beginHeight, targetHeight,
+            [&](RewardType type, CTokenAmount amount, uint32_t begin, uint32_t end) {
+                if (onReward) {
+                    onReward(poolId, type, amount, begin, end);
+                }
+                const CAmount blocks = end - begin;
+                // credit per block only if the range total does not fit
+                if (amount.nValue > std::numeric_limits<CAmount>::max() / blocks) {
+                    for (auto height = begin; height < end; ++height) {
+                        auto res = AddBalance(owner, amount);
+                        if (!res) {
+                            LogPrintf("Pool rewards: can't update balance of %s: %s, height %ld\n", owner.GetHex(), res.msg, targetHeight);
+                        }
+                    }
+                    return;
+                }
+                amount.nValue *= blocks;
                 auto res = AddBalance(owner, amount);
                 if (!res) {
                     LogPrintf("Pool rewards: can't update balance of %s: %s, height %ld\n", owner.GetHex(), res.msg, targetHeight);
@@ -956,6 +1047,95 @@ ResVal<CCollateralLoans> CCustomCSView::GetLoanCollaterals(CVaultId const& vault
     return ResVal<CCollateralLoans>(result, Res::Ok());
 }
 
+bool CLiquidationCheck::operator()()
+{
+    *candidate = view->GetLiquidationCandidate(vaultId, height, blockTime, ratio);
+    return true;
+}
+
+Optional<CLiquidationCandidate> CCustomCSView::GetLiquidationCandidate(const CVaultId& vaultId, uint32_t height, int64_t blockTime, CVaultRatio* ratio)
+{
+    if (ratio) {
+        *ratio = CVaultRatio{uint8_t(VaultRatioState::Unevaluated), height, 0, 0};
+    }
+    auto collaterals = GetVaultCollaterals(vaultId);
+    if (!collaterals) {
+        return {};
+    }
+    auto collateral = GetLoanCollaterals(vaultId, *collaterals, height, blockTime, false, true);
+    if (!collateral) {
+        // priced without live prices the vault is frozen, otherwise it can't be valued at all
+        if (ratio) {
+            if (auto frozen = GetLoanCollaterals(vaultId, *collaterals, height, blockTime, false, false)) {
+                *ratio = CVaultRatio{uint8_t(VaultRatioState::Frozen), height, frozen.val->totalCollaterals, frozen.val->totalLoans};
+            }
+        }
+        return {};
+    }
+    auto vault = GetVault(vaultId);
+    assert(vault);
+    auto scheme = GetLoanScheme(vault->schemeId);
+    assert(scheme);
+    if (scheme->ratio <= collateral.val->ratio()) {
+        if (ratio) {
+            auto next = GetLoanCollaterals(vaultId, *collaterals, height, blockTime, true, false);
+            auto state = next && next.val->ratio() < scheme->ratio ? VaultRatioState::MayLiquidate : VaultRatioState::Active;
+            *ratio = CVaultRatio{uint8_t(state), height, collateral.val->totalCollaterals, collateral.val->totalLoans};
+        }
+        return {};
+    }
+    if (ratio) {
+        *ratio = CVaultRatio{uint8_t(VaultRatioState::InLiquidation), height, collateral.val->totalCollaterals, collateral.val->totalLoans};
+    }
+    return CLiquidationCandidate{vaultId, std::move(*collaterals), std::move(*collateral.val)};
+}
+
+std::vector<CLiquidationCandidate> CCustomCSView::GetLiquidationCandidates(uint32_t height, int64_t blockTime, CCheckQueue<CLiquidationCheck>* queue,
+                                                                           std::vector<std::pair<CVaultId, CVaultRatio>>* ratios)
+{
+    // Without loans the ratio is unbounded, such vaults can never fall below
+    // their scheme ratio, so walk loan holders instead of every collateral entry
+    std::vector<CVaultId> vaultIds;
+    ForEach<LoanTokenAmount, CVaultId, CBalances>([&](const CVaultId& vaultId, CLazySerialize<CBalances>) {
+        vaultIds.push_back(vaultId);
+        return true;
+    });
+
+    // Every check owns its slot, results keep vault id order whatever the worker
+    std::vector<Optional<CLiquidationCandidate>> slots(vaultIds.size());
+    std::vector<CVaultRatio> ratioSlots(ratios ? vaultIds.size() : 0);
+    std::vector<CLiquidationCheck> checks;
+    checks.reserve(vaultIds.size());
+    for (size_t i = 0; i < vaultIds.size(); ++i) {
+        checks.emplace_back(*this, vaultIds[i], height, blockTime, slots[i], ratios ? &ratioSlots[i] : nullptr);
+    }
+
+    if (queue) {
+        CCheckQueueControl<CLiquidationCheck> control(queue);
+        control.Add(checks);
+        control.Wait();
+    } else {
+        for (auto& check : checks) {
+            check();
+        }
+    }
+
+    if (ratios) {
+        ratios->reserve(ratios->size() + vaultIds.size());
+        for (size_t i = 0; i < vaultIds.size(); ++i) {
+            ratios->emplace_back(vaultIds[i], ratioSlots[i]);
+        }
+    }
+
+    std::vector<CLiquidationCandidate> candidates;
+    for (auto& slot : slots) {
+        if (slot) {
+            candidates.push_back(std::move(*slot));
+        }
+    }
+    return candidates;
+}
+
 ResVal<CAmount> CCustomCSView::GetValidatedIntervalPrice(CTokenCurrencyPair priceFeedId, bool useNextPrice, bool requireLivePrice)
 {
     auto tokenSymbol = priceFeedId.first;
@@ -1051,10 +1231,12 @@ uint256 CCustomCSView::MerkleRoot() {
     if (rawMap.empty()) {
         return {};
     }
+    static const TValueBytes erased;
     std::vector<uint256> hashes;
+    hashes.reserve(rawMap.size());
     for (const auto& it : rawMap) {
-        auto value = it.second ? *it.second : TBytes{};
-        hashes.push_back(Hash2(it.first, value));
+        const auto& value = it.second ? *it.second : erased;
+        hashes.push_back(Hash(it.first.begin(), it.first.end(), value.begin(), value.end()));
     }
     return ComputeMerkleRoot(std::move(hashes));
 }
@@ -6,6 +6,7 @@
 #define DEFI_MASTERNODES_MASTERNODES_H
 
 #include <amount.h>
+#include <checkqueue.h>
 #include <flushablestorage.h>
 #include <pubkey.h>
 #include <serialize.h>
@@ -323,6 +324,40 @@ public:
     }
 };
 
+struct CLiquidationCandidate {
+    CVaultId vaultId;
+    CBalances collaterals;
+    CCollateralLoans collateral;
+};
+
+class CCustomCSView;
+
+/** Evaluates a single vault against its loan scheme, only reads from the view */
+class CLiquidationCheck {
+    CCustomCSView* view{nullptr};
+    CVaultId vaultId;
+    uint32_t height{0};
+    int64_t blockTime{0};
+    Optional<CLiquidationCandidate>* candidate{nullptr};
+    CVaultRatio* ratio{nullptr};
+
+public:
+    CLiquidationCheck() = default;
+    CLiquidationCheck(CCustomCSView& view, const CVaultId& vaultId, uint32_t height, int64_t blockTime, Optional<CLiquidationCandidate>& candidate, CVaultRatio* ratio = nullptr)
+        : view(&view), vaultId(vaultId), height(height), blockTime(blockTime), candidate(&candidate), ratio(ratio) {}
+
+    bool operator()();
+
+    void swap(CLiquidationCheck& check) {
+        std::swap(view, check.view);
+        std::swap(vaultId, check.vaultId);
+        std::swap(height, check.height);
+        std::swap(blockTime, check.blockTime);
+        std::swap(candidate, check.candidate);
+        std::swap(ratio, check.ratio);
+    }
+};
+
 template<typename T>
 inline void CheckPrefix()
 {
@@ -365,13 +400,13 @@ class CCustomCSView
             CTokensView             ::  ID, Symbol, CreationTx, LastDctId,
             CAccountsView           ::  ByBalanceKey, ByHeightKey,
             CCommunityBalancesView  ::  ById,
-            CUndosView              ::  ByUndoKey,
+            CUndosView              ::  ByUndoKey, ByBlockUndo,
             CPoolPairView           ::  ByID, ByPair, ByShare, ByIDPair, ByPoolSwap, ByReserves, ByRewardPct, ByRewardLoanPct,
                                         ByPoolReward, ByDailyReward, ByCustomReward, ByTotalLiquidity, ByDailyLoanReward,
                                         ByPoolLoanReward, ByTokenDexFeePct,
             CGovView                ::  ByName, ByHeightVars,
             CAnchorConfirmsView     ::  BtcTx,
-            COracleView             ::  ByName, FixedIntervalBlockKey, FixedIntervalPriceKey, PriceDeviation,
+            COracleView             ::  ByName, ByOraclePair, PairIndexReady, FixedIntervalBlockKey, FixedIntervalPriceKey, PriceDeviation,
             CICXOrderView           ::  ICXOrderCreationTx, ICXMakeOfferCreationTx, ICXSubmitDFCHTLCCreationTx,
                                         ICXSubmitEXTHTLCCreationTx, ICXClaimDFCHTLCCreationTx, ICXCloseOrderCreationTx,
                                         ICXCloseOfferCreationTx, ICXOrderOpenKey, ICXOrderCloseKey, ICXMakeOfferOpenKey,
@@ -381,7 +416,8 @@ class CCustomCSView
             CLoanView               ::  LoanSetCollateralTokenCreationTx, LoanSetCollateralTokenKey, LoanSetLoanTokenCreationTx,
                                         LoanSetLoanTokenKey, LoanSchemeKey, DefaultLoanSchemeKey, DelayedLoanSchemeKey,
                                         DestroyLoanSchemeKey, LoanInterestByVault, LoanTokenAmount, LoanLiquidationPenalty, LoanInterestV2ByVault,
-            CVaultView              ::  VaultKey, OwnerVaultKey, CollateralKey, AuctionBatchKey, AuctionHeightKey, AuctionBidKey
+            CVaultView              ::  VaultKey, OwnerVaultKey, CollateralKey, AuctionBatchKey, AuctionHeightKey, AuctionBidKey,
+                                        SchemeVaultKey, VaultStateKey, VaultRatioKey, VaultIndexReady
         >();
     }
 private:
@@ -420,11 +456,15 @@ public:
     void CreateAndRelayConfirmMessageIfNeed(const CAnchorIndex::AnchorRec* anchor, const uint256 & btcTxHash, const CKey &masternodeKey);
 
     // simplified version of undo, without any unnecessary undo data
-    void OnUndoTx(uint256 const & txid, uint32_t height);
+    void OnUndoTx(uint256 const & txid, uint32_t height, CBlockCustomUndo const * blockUndo = nullptr);
+
+    // moves the per tx undo of a block, not yet flushed from this view, into one block record
+    void CompactBlockUndo(uint32_t height);
 
     bool CanSpend(const uint256 & txId, int height) const;
 
-    bool CalculateOwnerRewards(CScript const & owner, uint32_t height);
+    // credits rewards since the owner balances height, onReward gets each pool range with its per block amount
+    bool CalculateOwnerRewards(CScript const & owner, uint32_t height, std::function<void(DCT_ID, RewardType, CTokenAmount, uint32_t, uint32_t)> onReward = {});
 
     ResVal<CAmount> GetAmountInCurrency(CAmount amount, CTokenCurrencyPair priceFeedId, bool useNextPrice = false, bool requireLivePrice = true);
 
@@ -432,6 +472,15 @@ public:
 
     ResVal<CAmount> GetValidatedIntervalPrice(CTokenCurrencyPair priceFeedId, bool useNextPrice, bool requireLivePrice);
 
+    // With ratio set, also records the vault state and values for the vault indexes
+    Optional<CLiquidationCandidate> GetLiquidationCandidate(const CVaultId& vaultId, uint32_t height, int64_t blockTime, CVaultRatio* ratio = nullptr);
+
+    // Vaults whose collateral ratio is below their scheme ratio, in vault id order.
+    // With a queue, vaults are evaluated by its workers while the view is left untouched.
+    // With ratios, every evaluated vault is reported along with its ratio record.
+    std::vector<CLiquidationCandidate> GetLiquidationCandidates(uint32_t height, int64_t blockTime, CCheckQueue<CLiquidationCheck>* queue = nullptr,
+                                                                std::vector<std::pair<CVaultId, CVaultRatio>>* ratios = nullptr);
+
     void SetDbVersion(int version);
 
     int GetDbVersion() const;
@@ -2711,6 +2711,8 @@ public:
             if (!res)
                 return res;
 
+            mnview.MarkVaultChanged(obj.vaultId);
+
             res = mnview.StoreInterest(height, obj.vaultId, vault->schemeId, tokenId, kv.second);
             if (!res)
                 return res;
@@ -2885,6 +2887,8 @@ public:
             if (!res)
                 return res;
 
+            mnview.MarkVaultChanged(obj.vaultId);
+
             LogPrint(BCLog::LOAN,"CLoanPaybackLoanMessage()->%s->", loanToken->symbol); /* Continued */
             res = mnview.EraseInterest(height, obj.vaultId, vault->schemeId, tokenId, subLoan, subInterest);
             if (!res)
@@ -3511,6 +3515,167 @@ Res ApplyCustomTx(CCustomCSView& mnview, const CCoinsViewCache& coins, const CTr
     return res;
 }
 
+bool IsSpeculativeCustomTx(CustomTxType txType)
+{
+    switch (txType) {
+        case CustomTxType::UtxosToAccount:
+        case CustomTxType::AccountToUtxos:
+        case CustomTxType::AccountToAccount:
+        case CustomTxType::AnyAccountsToAccounts:
+        case CustomTxType::PoolSwap:
+        case CustomTxType::PoolSwapV2:
+        case CustomTxType::AddPoolLiquidity:
+        case CustomTxType::RemovePoolLiquidity:
+        case CustomTxType::SetOracleData:
+        case CustomTxType::DepositToVault:
+        case CustomTxType::WithdrawFromVault:
+        case CustomTxType::TakeLoan:
+        case CustomTxType::PaybackLoan:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Coins backend of a tx applied ahead of its turn, it is only given the coins of the tx inputs
+class CCoinsViewMissed : public CCoinsView {
+public:
+    mutable bool missed{false};
+
+    bool GetCoin(const COutPoint&, Coin&) const override {
+        missed = true;
+        return false;
+    }
+};
+
+struct CCustomTxSpeculation {
+    CCustomCSView view;
+    CCoinsViewMissed missed;
+    CCoinsViewCache coins;
+    CHistoryWriters writers;
+    CStorageReadSet reads;
+    Res res{Res::Ok()};
+    bool thrown{false};
+
+    explicit CCustomTxSpeculation(CCustomCSView& base)
+        : view(base), coins(&missed), writers{paccountHistoryDB.get(), pburnHistoryDB.get(), pvaultHistoryDB.get()} {
+        writers.Hold();
+    }
+};
+
+bool CCustomTxCheck::operator()()
+{
+    auto& storage = speculation->view.GetStorage();
+    storage.TrackReads(&speculation->reads);
+    try {
+        speculation->res = ApplyCustomTx(speculation->view, speculation->coins, *tx, *consensus, height, time, txn, &speculation->writers);
+    } catch (...) {
+        // applied again in turn, where the error is raised as it would be
+        speculation->thrown = true;
+    }
+    storage.TrackReads(nullptr);
+    return true;
+}
+
+CCustomTxExecutor::CCustomTxExecutor(CCustomCSView& view, const CCoinsViewCache& coins, const CBlock& block, const Consensus::Params& consensus, uint32_t height, uint64_t time, CCheckQueue<CCustomTxCheck>* queue)
+    : view(view), coins(coins), block(block), consensus(consensus), height(height), time(time)
+{
+    if (!queue) {
+        return;
+    }
+    const auto metadataValidation = height >= consensus.FortCanningHeight;
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 1; i < block.vtx.size(); ++i) {
+        std::vector<unsigned char> metadata;
+        if (IsSpeculativeCustomTx(GuessCustomTxType(*block.vtx[i], metadata, metadataValidation))) {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.size() < 2) {
+        return;
+    }
+
+    // outputs of earlier txs in the block are the only coins not in the view yet
+    std::map<uint256, uint32_t> blockTxs;
+    for (uint32_t i = 0; i < block.vtx.size(); ++i) {
+        blockTxs.emplace(block.vtx[i]->GetHash(), i);
+    }
+    speculations.resize(block.vtx.size());
+    std::vector<CCustomTxCheck> checks;
+    checks.reserve(candidates.size());
+    for (const auto txn : candidates) {
+        const auto& tx = *block.vtx[txn];
+        auto speculation = MakeUnique<CCustomTxSpeculation>(view);
+        for (const auto& input : tx.vin) {
+            auto it = blockTxs.find(input.prevout.hash);
+            if (it != blockTxs.end() && it->second < txn) {
+                const auto& prevTx = *block.vtx[it->second];
+                if (input.prevout.n < prevTx.vout.size()) {
+                    speculation->coins.AddCoin(input.prevout, Coin(prevTx.vout[input.prevout.n], height, prevTx.IsCoinBase()), true);
+                }
+                continue;
+            }
+            const auto& coin = coins.AccessCoin(input.prevout);
+            if (!coin.IsSpent()) {
+                speculation->coins.AddCoin(input.prevout, Coin(coin), true);
+            }
+        }
+        checks.emplace_back(*speculation, tx, consensus, height, time, txn);
+        speculations[txn] = std::move(speculation);
+    }
+    speculated = checks.size();
+
+    auto t0 = GetTimeMicros();
+    CCheckQueueControl<CCustomTxCheck> control(queue);
+    control.Add(checks);
+    control.Wait();
+    if (getenv("DEFI_SPECLOG")) fprintf(stderr, "specphase %lld us\n", (long long)(GetTimeMicros() - t0));
+}
+
+CCustomTxExecutor::~CCustomTxExecutor() = default;
+
+void CCustomTxExecutor::RecordWrites(const MapKV& changes)
+{
+    for (const auto& kv : changes) {
+        written.emplace(kv.first.begin(), kv.first.end());
+    }
+}
+
+Res CCustomTxExecutor::Apply(uint32_t txn, CHistoryWriters* writers)
+{
+    const auto& tx = *block.vtx[txn];
+    if (speculations.empty()) {
+        return ApplyCustomTx(view, coins, tx, consensus, height, time, txn, writers);
+    }
+    auto speculation = std::move(speculations[txn]);
+    if (speculation && getenv("DEFI_SPECLOG")) {
+        std::string why;
+        for (auto& k : speculation->reads.keys) if (written.count(k)) why += strprintf("k%c", k[0]);
+        for (auto p : speculation->reads.prefixes) { auto it = written.lower_bound(TBytes{p}); if (it != written.end() && (*it)[0] == p) why += strprintf("p%c", p); }
+        for (auto& r : speculation->reads.ranges) { auto it = written.lower_bound(r.begin); if (it != written.end() && (r.open || !std::lexicographical_compare(r.end.begin(), r.end.end(), it->begin(), it->end()))) why += strprintf("r%c%s", r.begin.empty() ? '-' : r.begin[0], r.open ? "+" : ""); }
+        fprintf(stderr, "tx %u missed %d reads %zu ranges %zu [%s]\n", txn, speculation->missed.missed, speculation->reads.keys.size(), speculation->reads.ranges.size(), why.c_str());
+    }
+    if (speculation && !speculation->thrown && !speculation->missed.missed && !speculation->reads.Conflicts(written)) {
+        // nothing it read has changed, so its layer holds what applying it now would write, undo included
+        auto& changes = speculation->view.GetStorage().GetRaw();
+        RecordWrites(changes);
+        speculation->view.Flush();
+        speculation->writers.Release();
+        ++committed;
+        return speculation->res;
+    }
+    CCustomCSView txView(view);
+    auto res = ApplyCustomTx(txView, coins, tx, consensus, height, time, txn, writers);
+    RecordWrites(txView.GetStorage().GetRaw());
+    txView.Flush();
+    return res;
+}
+
+void CCustomTxExecutor::Invalidate()
+{
+    speculations.clear();
+}
+
 ResVal<uint256> ApplyAnchorRewardTx(CCustomCSView & mnview, CTransaction const & tx, int height, uint256 const & prevStakeModifier, std::vector<unsigned char> const & metadata, Consensus::Params const & consensusParams)
 {
     if (height >= consensusParams.DakotaHeight) {
@@ -3666,109 +3831,195 @@ bool IsMempooledCustomTxCreate(const CTxMemPool & pool, const uint256 & txid)
     return false;
 }
 
-std::vector<DCT_ID> CPoolSwap::CalculateSwaps(CCustomCSView& view, bool testOnly) {
-
-    std::vector<std::vector<DCT_ID>> poolPaths = CalculatePoolPaths(view);
+std::vector<DCT_ID> CPoolSwap::CalculateSwaps(CCustomCSView& view, bool testOnly, size_t maxPools, CPoolSwapCache* cache) {
 
-    // Record best pair
-    std::pair<std::vector<DCT_ID>, CAmount> bestPair{{}, -1};
+    std::vector<std::vector<DCT_ID>> poolPaths = CalculatePoolPaths(view, maxPools);
 
-    // Loop through all common pairs
-    for (const auto& path : poolPaths) {
-
-        // Test on copy of view
-        CCustomCSView dummy(view);
-
-        // Execute pool path
-        auto res = ExecuteSwap(dummy, path, testOnly);
+    // Rank paths on pool reserves only, each pool is read once for all paths
+    CPoolSwapCache localCache;
+    auto& swapCache = cache ? *cache : localCache;
+    std::vector<std::pair<CAmount, size_t>> ranked;
+    for (size_t i{0}; i < poolPaths.size(); ++i) {
+        auto res = SimulateSwap(view, poolPaths[i], swapCache);
 
         // Add error for RPC user feedback
         if (!res) {
-            const auto token = dummy.GetToken(currentID);
+            const auto token = view.GetToken(currentID);
             if (token) {
                 errors.emplace_back(token->symbol, res.msg);
             }
+            continue;
         }
+        ranked.emplace_back(*res.val, i);
+    }
+
+    // Best amount first, equal amounts keep path order
+    std::stable_sort(ranked.begin(), ranked.end(), [](const std::pair<CAmount, size_t>& a, const std::pair<CAmount, size_t>& b) {
+        return a.first > b.first;
+    });
+
+    for (const auto& item : ranked) {
+        const auto& path = poolPaths[item.second];
 
-        // Record amount if more than previous or default value
-        if (res && result > bestPair.second) {
-            bestPair = {path, result};
+        // Simulation is exactly what a test swap computes
+        if (testOnly) {
+            return path;
+        }
+
+        // Balances and rewards only come into play on a real swap, replay on copy of view
+        CCustomCSView dummy(view);
+        auto res = ExecuteSwap(dummy, path);
+        if (res) {
+            return path;
+        }
+
+        const auto token = dummy.GetToken(currentID);
+        if (token) {
+            errors.emplace_back(token->symbol, res.msg);
         }
     }
 
-    return bestPair.first;
+    return {};
 }
 
-std::vector<std::vector<DCT_ID>> CPoolSwap::CalculatePoolPaths(CCustomCSView& view) {
+std::vector<std::vector<DCT_ID>> CPoolSwap::CalculatePoolPaths(CCustomCSView& view, size_t maxPools) {
 
-    // For tokens to be traded get all pairs and pool IDs
-    std::multimap<uint32_t, DCT_ID> fromPoolsID, toPoolsID;
-    view.ForEachPoolPair([&](DCT_ID const & id, const CPoolPair& pool) {
-        if (pool.idTokenA == obj.idTokenFrom) {
-            fromPoolsID.emplace(pool.idTokenB.v, id);
-        } else if (pool.idTokenB == obj.idTokenFrom) {
-            fromPoolsID.emplace(pool.idTokenA.v, id);
+    const auto graph = view.GetPoolGraph();
+
+    std::vector<std::vector<DCT_ID>> poolPaths;
+    std::vector<DCT_ID> path;
+    std::set<DCT_ID> visited{obj.idTokenFrom};
+
+    // Depth first over tokens, a token is never visited twice so neither is a pool
+    std::function<void(DCT_ID)> walk = [&](DCT_ID tokenId) {
+        const auto edges = graph->find(tokenId);
+        if (edges == graph->end()) {
+            return;
+        }
+        for (const auto& edge : edges->second) {
+            const auto& poolId = edge.first;
+            const auto& otherId = edge.second;
+
+            if (otherId == obj.idTokenTo) {
+                // Direct pool is a plain swap, composite paths have at least two pools
+                if (!path.empty()) {
+                    path.push_back(poolId);
+                    poolPaths.push_back(path);
+                    path.pop_back();
+                }
+                continue;
+            }
+
+            if (path.size() + 2 > maxPools || visited.count(otherId)) {
+                continue;
+            }
+
+            visited.insert(otherId);
+            path.push_back(poolId);
+            walk(otherId);
+            path.pop_back();
+            visited.erase(otherId);
         }
+    };
+    walk(obj.idTokenFrom);
+
+    // return pool paths
+    return poolPaths;
+}
+
+// Same result as a test ExecuteSwap, without copying views.
+// Pools and dex fees are read through `cache` so that swaps over a shared pool read it once.
+ResVal<CAmount> CPoolSwap::SimulateSwap(CCustomCSView& view, std::vector<DCT_ID> poolIDs, CPoolSwapCache& cache) {
+
+    // No composite swap allowed before Fort Canning
+    if (height < Params().GetConsensus().FortCanningHeight && !poolIDs.empty()) {
+        poolIDs.clear();
+    }
 
-        if (pool.idTokenA == obj.idTokenTo) {
-            toPoolsID.emplace(pool.idTokenB.v, id);
-        } else if (pool.idTokenB == obj.idTokenTo) {
-            toPoolsID.emplace(pool.idTokenA.v, id);
+    if (obj.amountFrom <= 0) {
+        return Res::Err("Input amount should be positive");
+    }
+
+    // Single swap if no pool IDs provided
+    auto poolPrice = POOLPRICE_MAX;
+    if (poolIDs.empty()) {
+        auto poolPair = view.GetPoolPair(obj.idTokenFrom, obj.idTokenTo);
+        if (!poolPair) {
+            return Res::Err("Cannot find the pool pair.");
         }
-        return true;
-    }, {0});
+        cache.pools.emplace(poolPair->first, std::move(poolPair->second));
+        poolIDs.push_back(poolPair->first);
 
-    if (fromPoolsID.empty() || toPoolsID.empty()) {
-        return {};
+        // Get legacy max price
+        poolPrice = obj.maxPrice;
     }
 
-    // Find intersection on key
-    std::map<uint32_t, DCT_ID> commonPairs;
-    set_intersection(fromPoolsID.begin(), fromPoolsID.end(), toPoolsID.begin(), toPoolsID.end(),
-                     std::inserter(commonPairs, commonPairs.begin()),
-                     [](std::pair<uint32_t, DCT_ID> a, std::pair<uint32_t, DCT_ID> b) {
-                         return a.first < b.first;
-                     });
+    auto getDexFeePct = [&](DCT_ID poolId, DCT_ID tokenId) {
+        auto it = cache.dexFees.find({poolId, tokenId});
+        if (it == cache.dexFees.end()) {
+            it = cache.dexFees.emplace(std::make_pair(poolId, tokenId), view.GetDexFeePct(poolId, tokenId)).first;
+        }
+        return it->second;
+    };
+
+    CTokenAmount swapAmountResult{obj.idTokenFrom, obj.amountFrom};
 
-    // Loop through all common pairs and record direct pool to pool swaps
-    std::vector<std::vector<DCT_ID>> poolPaths;
-    for (const auto& item : commonPairs) {
+    for (size_t i{0}; i < poolIDs.size(); ++i) {
 
-        // Loop through all source/intermediate pools matching common pairs
-        const auto poolFromIDs = fromPoolsID.equal_range(item.first);
-        for (auto fromID = poolFromIDs.first; fromID != poolFromIDs.second; ++fromID) {
+        currentID = poolIDs[i];
 
-            // Loop through all destination pools matching common pairs
-            const auto poolToIDs = toPoolsID.equal_range(item.first);
-            for (auto toID = poolToIDs.first; toID != poolToIDs.second; ++toID) {
+        auto it = cache.pools.find(currentID);
+        if (it == cache.pools.end()) {
+            it = cache.pools.emplace(currentID, view.GetPoolPair(currentID)).first;
+        }
+        if (!it->second) {
+            return Res::Err("Cannot find the pool pair.");
+        }
+        // Swap moves reserves, keep the cached pool intact
+        auto pool = *it->second;
+
+        bool lastSwap = i + 1 == poolIDs.size();
+
+        const auto swapAmount = swapAmountResult;
 
-                // Add to pool paths
-                poolPaths.push_back({fromID->second, toID->second});
+        if (height >= static_cast<uint32_t>(Params().GetConsensus().FortCanningHillHeight) && lastSwap) {
+            if (obj.idTokenTo == swapAmount.nTokenId) {
+                return Res::Err("Final swap should have idTokenTo as destination, not source");
+            }
+            if (pool.idTokenA != obj.idTokenTo && pool.idTokenB != obj.idTokenTo) {
+                return Res::Err("Final swap pool should have idTokenTo, incorrect final pool ID provided");
             }
         }
-    }
-
-    // Look for pools that bridges token. Might be in addition to common token pairs paths.
-    view.ForEachPoolPair([&](DCT_ID const & id, const CPoolPair& pool) {
 
-        // Loop through from pool multimap on unique keys only
-        for (auto fromIt = fromPoolsID.begin(); fromIt != fromPoolsID.end(); fromIt = fromPoolsID.equal_range(fromIt->first).second) {
+        auto dexfeeInPct = getDexFeePct(currentID, swapAmount.nTokenId);
 
-            // Loop through to pool multimap on unique keys only
-            for (auto toIt = toPoolsID.begin(); toIt != toPoolsID.end(); toIt = toPoolsID.equal_range(toIt->first).second) {
+        auto res = pool.Swap(swapAmount, dexfeeInPct, poolPrice, [&] (const CTokenAmount &, const CTokenAmount& tokenAmount) {
+            swapAmountResult = tokenAmount;
 
-                // If a pool pairs matches from pair and to pair add it to the pool paths
-                if ((fromIt->first == pool.idTokenA.v && toIt->first == pool.idTokenB.v) ||
-                    (fromIt->first == pool.idTokenB.v && toIt->first == pool.idTokenA.v)) {
-                    poolPaths.push_back({fromIt->second, id, toIt->second});
+            if (height >= Params().GetConsensus().FortCanningHillHeight) {
+                if (auto dexfeeOutPct = getDexFeePct(currentID, tokenAmount.nTokenId)) {
+                    swapAmountResult.nValue -= MultiplyAmounts(tokenAmount.nValue, dexfeeOutPct);
                 }
             }
+            return Res::Ok();
+        }, static_cast<int>(height));
+
+        if (!res) {
+            return res;
         }
-        return true;
-    }, {0});
+    }
 
-    // return pool paths
-    return poolPaths;
+    // Reject if price paid post-swap above max price provided
+    if (height >= Params().GetConsensus().FortCanningHeight && obj.maxPrice != POOLPRICE_MAX) {
+        if (swapAmountResult.nValue != 0) {
+            const auto userMaxPrice = arith_uint256(obj.maxPrice.integer) * COIN + obj.maxPrice.fraction;
+            if (arith_uint256(obj.amountFrom) * COIN / swapAmountResult.nValue > userMaxPrice) {
+                return Res::Err("Price is higher than indicated.");
+            }
+        }
+    }
+
+    return ResVal<CAmount>(swapAmountResult.nValue, Res::Ok());
 }
 
 // Note: `testOnly` doesn't update views, and as such can result in a previous price calculations
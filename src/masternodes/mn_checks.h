@@ -380,7 +380,71 @@ Res RevertCustomTx(CCustomCSView& mnview, const CCoinsViewCache& coins, const CT
 Res CustomTxVisit(CCustomCSView& mnview, const CCoinsViewCache& coins, const CTransaction& tx, uint32_t height, const Consensus::Params& consensus, const CCustomTxMessage& txMessage, uint64_t time = 0);
 ResVal<uint256> ApplyAnchorRewardTx(CCustomCSView& mnview, const CTransaction& tx, int height, const uint256& prevStakeModifier, const std::vector<unsigned char>& metadata, const Consensus::Params& consensusParams);
 ResVal<uint256> ApplyAnchorRewardTxPlus(CCustomCSView& mnview, const CTransaction& tx, int height, const std::vector<unsigned char>& metadata, const Consensus::Params& consensusParams);
+// Types applied ahead of their turn by CCustomTxExecutor, they only read state through the view and the coins of their inputs
+bool IsSpeculativeCustomTx(CustomTxType txType);
+
+struct CCustomTxSpeculation;
+
+/** Applies one custom tx of a block ahead of its turn, on its own layer recording the keys it reads */
+class CCustomTxCheck {
+    CCustomTxSpeculation* speculation{nullptr};
+    const CTransaction* tx{nullptr};
+    const Consensus::Params* consensus{nullptr};
+    uint32_t height{0};
+    uint64_t time{0};
+    uint32_t txn{0};
+
+public:
+    CCustomTxCheck() = default;
+    CCustomTxCheck(CCustomTxSpeculation& speculation, const CTransaction& tx, const Consensus::Params& consensus, uint32_t height, uint64_t time, uint32_t txn)
+        : speculation(&speculation), tx(&tx), consensus(&consensus), height(height), time(time), txn(txn) {}
+
+    bool operator()();
+
+    void swap(CCustomTxCheck& check) {
+        std::swap(speculation, check.speculation);
+        std::swap(tx, check.tx);
+        std::swap(consensus, check.consensus);
+        std::swap(height, check.height);
+        std::swap(time, check.time);
+        std::swap(txn, check.txn);
+    }
+};
+
+/** Optimistic execution of the custom txs of a block. Speculative types are applied up front on the
+ *  worker queue, each over the block's view on its own layer. In block order a result is committed
+ *  when nothing written by the block since touched the keys it read, otherwise the tx is applied
+ *  again, so results, undo and history match applying the txs one by one. */
+class CCustomTxExecutor {
+    CCustomCSView& view;
+    const CCoinsViewCache& coins;
+    const CBlock& block;
+    const Consensus::Params& consensus;
+    const uint32_t height;
+    const uint64_t time;
+    std::vector<std::unique_ptr<CCustomTxSpeculation>> speculations;
+    // keys written to view by the block so far
+    std::set<TBytes> written;
+    size_t speculated{0};
+    size_t committed{0};
+
+    void RecordWrites(const MapKV& changes);
+
+public:
+    CCustomTxExecutor(CCustomCSView& view, const CCoinsViewCache& coins, const CBlock& block, const Consensus::Params& consensus, uint32_t height, uint64_t time, CCheckQueue<CCustomTxCheck>* queue);
+    ~CCustomTxExecutor();
+
+    // Same result and effects as ApplyCustomTx of tx txn of the block on view
+    Res Apply(uint32_t txn, CHistoryWriters* writers);
+    // Drops the results applied ahead, for changes made below view
+    void Invalidate();
+
+    size_t Speculated() const { return speculated; }
+    size_t Committed() const { return committed; }
+};
+
 ResVal<CAmount> GetAggregatePrice(CCustomCSView& view, const std::string& token, const std::string& currency, uint64_t lastBlockTime);
+std::map<CTokenCurrencyPair, ResVal<CAmount>> GetAggregatePrices(CCustomCSView& view, const std::set<CTokenCurrencyPair>& pairs, uint64_t lastBlockTime);
 bool IsVaultPriceValid(CCustomCSView& mnview, const CVaultId& vaultId, uint32_t height);
 Res SwapToDFIOverUSD(CCustomCSView & mnview, DCT_ID tokenId, CAmount amount, CScript const & from, CScript const & to, uint32_t height);
 
@@ -473,6 +537,15 @@ inline CAmount GetNonMintedValueOut(const CTransaction & tx, DCT_ID tokenID)
     return tx.GetValueOut(mintingOutputsStart, tokenID);
 }
 
+/** Longest composite swap accepted on chain */
+static const size_t MAX_POOLSWAP_POOLS = 3;
+
+/** Pool pairs and dex fees read once, shared by every swap simulated on the same view */
+struct CPoolSwapCache {
+    std::map<DCT_ID, boost::optional<CPoolPair>> pools;
+    std::map<std::pair<DCT_ID, DCT_ID>, CAmount> dexFees;
+};
+
 class CPoolSwap {
     const CPoolSwapMessage& obj;
     uint32_t height;
@@ -485,9 +558,10 @@ public:
     CPoolSwap(const CPoolSwapMessage& obj, uint32_t height)
     : obj(obj), height(height) {}
 
-    std::vector<DCT_ID> CalculateSwaps(CCustomCSView& view, bool testOnly = false);
+    std::vector<DCT_ID> CalculateSwaps(CCustomCSView& view, bool testOnly = false, size_t maxPools = MAX_POOLSWAP_POOLS, CPoolSwapCache* cache = nullptr);
     Res ExecuteSwap(CCustomCSView& view, std::vector<DCT_ID> poolIDs, bool testOnly = false);
-    std::vector<std::vector<DCT_ID>> CalculatePoolPaths(CCustomCSView& view);
+    ResVal<CAmount> SimulateSwap(CCustomCSView& view, std::vector<DCT_ID> poolIDs, CPoolSwapCache& cache);
+    std::vector<std::vector<DCT_ID>> CalculatePoolPaths(CCustomCSView& view, size_t maxPools = MAX_POOLSWAP_POOLS);
     CTokenAmount GetResult() { return CTokenAmount{obj.idTokenTo, result}; };
 };
 
@@ -33,12 +33,24 @@ ResVal<CAmount> COracle::GetTokenPrice(const std::string& token, const std::stri
     return ResVal<CAmount>(tokenPrices[token][currency].first, Res::Ok());
 }
 
+void COracleView::IndexPairs(const COracleId& oracleId, const std::set<CTokenCurrencyPair>& pairs, bool add)
+{
+    for (const auto& pair : pairs) {
+        if (add) {
+            WriteBy<ByOraclePair>(std::make_pair(pair, oracleId), '\0');
+        } else {
+            EraseBy<ByOraclePair>(std::make_pair(pair, oracleId));
+        }
+    }
+}
+
 Res COracleView::AppointOracle(const COracleId& oracleId, const COracle& oracle)
 {
     if (!WriteBy<ByName>(oracleId, oracle)) {
         return Res::Err("failed to appoint the new oracle <%s>", oracleId.GetHex());
     }
 
+    IndexPairs(oracleId, oracle.availablePairs, true);
     return Res::Ok();
 }
 
@@ -69,7 +81,9 @@ Res COracleView::UpdateOracle(const COracleId& oracleId, COracle&& newOracle)
     }
 
     oracle.tokenPrices = std::move(allowedPrices);
+    IndexPairs(oracleId, oracle.availablePairs, false);
     oracle.availablePairs = std::move(newOracle.availablePairs);
+    IndexPairs(oracleId, oracle.availablePairs, true);
 
     // no need to update oracles list
     if (!WriteBy<ByName>(oracleId, oracle)) {
@@ -81,10 +95,13 @@ Res COracleView::UpdateOracle(const COracleId& oracleId, COracle&& newOracle)
 
 Res COracleView::RemoveOracle(const COracleId& oracleId)
 {
-    if (!ExistsBy<ByName>(oracleId)) {
+    COracle oracle;
+    if (!ReadBy<ByName>(oracleId, oracle)) {
         return Res::Err("oracle <%s> not found", oracleId.GetHex());
     }
 
+    IndexPairs(oracleId, oracle.availablePairs, false);
+
     // remove oracle
     if (!EraseBy<ByName>(oracleId)) {
         return Res::Err("failed to remove oracle <%s>", oracleId.GetHex());
@@ -133,6 +150,32 @@ void COracleView::ForEachOracle(std::function<bool(const COracleId&, CLazySerial
     ForEach<ByName, COracleId, COracle>(callback, start);
 }
 
+void COracleView::ForEachOracleByPair(const CTokenCurrencyPair& pair, std::function<bool(const COracleId&)> callback)
+{
+    ForEach<ByOraclePair, std::pair<CTokenCurrencyPair, COracleId>, char>([&](const std::pair<CTokenCurrencyPair, COracleId>& key, CLazySerialize<char>) {
+        if (key.first != pair) {
+            return false;
+        }
+        return callback(key.second);
+    }, std::make_pair(pair, COracleId{}));
+}
+
+void COracleView::InitOraclePairIndex()
+{
+    if (Exists(PairIndexReady::prefix())) {
+        return;
+    }
+    std::vector<std::pair<COracleId, std::set<CTokenCurrencyPair>>> oracles;
+    ForEachOracle([&](const COracleId& oracleId, COracle oracle) {
+        oracles.emplace_back(oracleId, std::move(oracle.availablePairs));
+        return true;
+    });
+    for (const auto& oracle : oracles) {
+        IndexPairs(oracle.first, oracle.second, true);
+    }
+    Write(PairIndexReady::prefix(), true);
+}
+
 bool CFixedIntervalPrice::isLive(const CAmount deviationThreshold) const
 {
     return (
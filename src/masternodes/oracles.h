@@ -138,6 +138,12 @@ public:
 
     void ForEachOracle(std::function<bool(const COracleId&, CLazySerialize<COracle>)> callback, const COracleId& start = {});
 
+    /// iterate ids of oracles supporting token/currency pair, ordered by id
+    void ForEachOracleByPair(const CTokenCurrencyPair& pair, std::function<bool(const COracleId&)> callback);
+
+    /// index pairs of oracles appointed before the pair index existed
+    void InitOraclePairIndex();
+
     Res SetFixedIntervalPrice(const CFixedIntervalPrice& PriceFeed);
 
     ResVal<CFixedIntervalPrice> GetFixedIntervalPrice(const CTokenCurrencyPair& priceFeedId);
@@ -151,9 +157,14 @@ public:
     uint32_t GetIntervalBlock() const;
 
     struct ByName { static constexpr uint8_t prefix() { return 'O'; } };
+    struct ByOraclePair { static constexpr uint8_t prefix() { return 'N'; } };
+    struct PairIndexReady { static constexpr uint8_t prefix() { return 'n'; } };
     struct PriceDeviation { static constexpr uint8_t prefix() { return 'Y'; } };
     struct FixedIntervalBlockKey { static constexpr uint8_t prefix() { return 'z'; } };
     struct FixedIntervalPriceKey { static constexpr uint8_t prefix() { return 'y'; } };
+
+private:
+    void IndexPairs(const COracleId& oracleId, const std::set<CTokenCurrencyPair>& pairs, bool add);
 };
 
 #endif // DEFI_MASTERNODES_ORACLES_H
@@ -6,6 +6,10 @@
 #include <masternodes/poolpairs.h>
 #include <core_io.h>
 #include <primitives/transaction.h>
+#include <sync.h>
+
+static Mutex cs_poolGraph;
+static std::shared_ptr<const CPoolPairView::PoolGraph> poolGraph GUARDED_BY(cs_poolGraph);
 
 struct PoolSwapValue {
     bool swapEvent;
@@ -84,6 +88,10 @@ Res CPoolPairView::SetPoolPair(DCT_ID const & poolId, uint32_t height, CPoolPair
         WriteBy<ByPair>(ByPairKey{pool.idTokenA, pool.idTokenB}, poolId);
         WriteBy<ByPair>(ByPairKey{pool.idTokenB, pool.idTokenA}, poolId);
         WriteBy<ByIDPair>(poolId, ByPairKey{pool.idTokenA, pool.idTokenB});
+        {
+            LOCK(cs_poolGraph);
+            poolGraph.reset();
+        }
         return Res::Ok();
     }
 
@@ -159,7 +167,8 @@ Res CPoolPairView::UpdatePoolPair(DCT_ID const & poolId, uint32_t height, bool s
 
 boost::optional<CPoolPair> CPoolPairView::GetPoolPair(const DCT_ID &poolId) const
 {
-    auto pool = ReadBy<ByID, CPoolPair>(poolId);
+    // reserves and reward pcts change on every swap, only the pool itself is cached
+    auto pool = ReadCachedBy<ByID, CPoolPair>(poolId);
     if (!pool) {
         return {};
     }
@@ -318,6 +327,115 @@ void CPoolPairView::CalculatePoolRewards(DCT_ID const & poolId, std::function<CA
     }
 }
 
+void CPoolPairView::CalculatePoolRewardRanges(DCT_ID const & poolId, std::function<CAmount()> onLiquidity, uint32_t begin, uint32_t end, std::function<void(RewardType, CTokenAmount, uint32_t, uint32_t)> onReward) {
+    if (begin >= end) {
+        return;
+    }
+    constexpr const uint32_t PRECISION = 10000;
+    const auto newCalcHeight = uint32_t(Params().GetConsensus().BayfrontGardensHeight);
+
+    auto tokenIds = ReadBy<ByIDPair, ByPairKey>(poolId);
+    assert(tokenIds); // contract to verify pool data
+
+    PoolHeightKey poolKey = {poolId, begin};
+
+    CAmount poolReward = 0;
+    CAmount poolLoanReward = 0;
+    auto nextPoolReward = begin;
+    auto nextPoolLoanReward = begin;
+    auto itPoolReward = LowerBound<ByPoolReward>(poolKey);
+    auto itPoolLoanReward = LowerBound<ByPoolLoanReward>(poolKey);
+
+    CAmount totalLiquidity = 0;
+    auto nextTotalLiquidity = begin;
+    auto itTotalLiquidity = LowerBound<ByTotalLiquidity>(poolKey);
+
+    CBalances customRewards;
+    auto nextCustomRewards = begin;
+    auto itCustomRewards = LowerBound<ByCustomReward>(poolKey);
+
+    PoolSwapValue poolSwap;
+    auto nextPoolSwap = UINT_MAX;
+    auto poolSwapHeight = UINT_MAX;
+    auto itPoolSwap = LowerBound<ByPoolSwap>(poolKey);
+    if (itPoolSwap.Valid() && itPoolSwap.Key().poolID == poolId) {
+        nextPoolSwap = itPoolSwap.Key().height;
+    }
+
+    for (auto height = begin; height < end;) {
+        // find suitable pool liquidity
+        if (height == nextTotalLiquidity || totalLiquidity == 0) {
+            height = nextTotalLiquidity;
+            ReadValueMoveToNext(itTotalLiquidity, poolId, totalLiquidity, nextTotalLiquidity);
+            continue;
+        }
+        // adjust iterators to working height
+        while (height >= nextPoolReward) {
+            ReadValueMoveToNext(itPoolReward, poolId, poolReward, nextPoolReward);
+        }
+        while (height >= nextPoolLoanReward) {
+            ReadValueMoveToNext(itPoolLoanReward, poolId, poolLoanReward, nextPoolLoanReward);
+        }
+        while (height >= nextPoolSwap) {
+            poolSwapHeight = nextPoolSwap;
+            ReadValueMoveToNext(itPoolSwap, poolId, poolSwap, nextPoolSwap);
+        }
+        while (height >= nextCustomRewards) {
+            ReadValueMoveToNext(itCustomRewards, poolId, customRewards, nextCustomRewards);
+        }
+        // per block rewards stay the same until the next pool change
+        auto next = std::min({end, nextTotalLiquidity, nextPoolReward, nextPoolLoanReward, nextPoolSwap, nextCustomRewards});
+        if (height < newCalcHeight) {
+            next = std::min(next, newCalcHeight);
+        }
+        // rewards in the pool token itself change owner liquidity every block
+        if (customRewards.balances.count(poolId)) {
+            next = height + 1;
+        }
+        const auto liquidity = onLiquidity();
+        // daily rewards
+        if (poolReward != 0) {
+            CAmount providerReward = 0;
+            if (height < newCalcHeight) { // old calculation
+                uint32_t liqWeight = liquidity * PRECISION / totalLiquidity;
+                providerReward = poolReward * liqWeight / PRECISION;
+            } else { // new calculation
+                providerReward = liquidityReward(poolReward, liquidity, totalLiquidity);
+            }
+            onReward(RewardType::Coinbase, {DCT_ID{0}, providerReward}, height, next);
+        }
+        if (poolLoanReward != 0) {
+            CAmount providerReward = liquidityReward(poolLoanReward, liquidity, totalLiquidity);
+            onReward(RewardType::LoanTokenDEXReward, {DCT_ID{0}, providerReward}, height, next);
+        }
+        // commissions
+        if (poolSwapHeight == height && poolSwap.swapEvent) {
+            CAmount feeA, feeB;
+            if (height < newCalcHeight) {
+                uint32_t liqWeight = liquidity * PRECISION / totalLiquidity;
+                feeA = poolSwap.blockCommissionA * liqWeight / PRECISION;
+                feeB = poolSwap.blockCommissionB * liqWeight / PRECISION;
+            } else {
+                feeA = liquidityReward(poolSwap.blockCommissionA, liquidity, totalLiquidity);
+                feeB = liquidityReward(poolSwap.blockCommissionB, liquidity, totalLiquidity);
+            }
+            if (feeA) {
+                onReward(RewardType::Commission, {tokenIds->idTokenA, feeA}, height, height + 1);
+            }
+            if (feeB) {
+                onReward(RewardType::Commission, {tokenIds->idTokenB, feeB}, height, height + 1);
+            }
+        }
+        // custom rewards
+        for (const auto& reward : customRewards.balances) {
+            if (auto providerReward = liquidityReward(reward.second, liquidity, totalLiquidity)) {
+                onReward(RewardType::Pool, {reward.first, providerReward}, height, next);
+            }
+        }
+        height = next;
+    }
+}
+
 Res CPoolPair::AddLiquidity(CAmount amountA, CAmount amountB, std::function<Res(CAmount)> onMint, bool slippageProtection) {
     // instead of assertion due to tests
     if (amountA <= 0 || amountB <= 0) {
@@ -687,6 +805,28 @@ Res CPoolPairView::SetLoanDailyReward(const uint32_t height, const CAmount rewar
     return Res::Ok();
 }
 
+std::shared_ptr<const CPoolPairView::PoolGraph> CPoolPairView::GetPoolGraph()
+{
+    // a cached graph skips the walk of the pair table, tracked layers still count it as read
+    if (auto layer = dynamic_cast<CFlushableStorageKV*>(&DB())) {
+        if (auto reads = layer->GetReadSet()) {
+            reads->prefixes.insert(ByIDPair::prefix());
+        }
+    }
+    LOCK(cs_poolGraph);
+    if (!poolGraph) {
+        // token pair of a pool is fixed at creation, updates never move an edge
+        auto graph = std::make_shared<PoolGraph>();
+        ForEach<ByIDPair, DCT_ID, ByPairKey>([&](const DCT_ID& poolId, const ByPairKey& pair) {
+            (*graph)[pair.idTokenA].emplace_back(poolId, pair.idTokenB);
+            (*graph)[pair.idTokenB].emplace_back(poolId, pair.idTokenA);
+            return true;
+        });
+        poolGraph = std::move(graph);
+    }
+    return poolGraph;
+}
+
 bool CPoolPairView::HasPoolPair(DCT_ID const & poolId) const {
     return ExistsBy<ByID>(poolId);
 }
@@ -722,7 +862,7 @@ Res CPoolPairView::SetDexFeePct(DCT_ID poolId, DCT_ID tokenId, CAmount feePct) {
 
 CAmount CPoolPairView::GetDexFeePct(DCT_ID poolId, DCT_ID tokenId) const {
     uint32_t feePct;
-    if (ReadBy<ByTokenDexFeePct>(std::make_pair(poolId, tokenId), feePct)) {
+    if (ReadCachedBy<ByTokenDexFeePct>(std::make_pair(poolId, tokenId), feePct)) {
         return feePct;
     }
     return 0;
@@ -224,6 +224,8 @@ public:
     boost::optional<uint32_t> GetShare(DCT_ID const & poolId, CScript const & provider);
 
     void CalculatePoolRewards(DCT_ID const & poolId, std::function<CAmount()> onLiquidity, uint32_t begin, uint32_t end, std::function<void(RewardType, CTokenAmount, uint32_t)> onReward);
+    // same rewards as above, reported once per range of heights [begin, end) paying an equal amount each block
+    void CalculatePoolRewardRanges(DCT_ID const & poolId, std::function<CAmount()> onLiquidity, uint32_t begin, uint32_t end, std::function<void(RewardType, CTokenAmount, uint32_t, uint32_t)> onReward);
 
     Res SetLoanDailyReward(const uint32_t height, const CAmount reward);
     Res SetDailyReward(uint32_t height, CAmount reward);
@@ -234,6 +236,11 @@ public:
     Res SetDexFeePct(DCT_ID poolId, DCT_ID tokenId, CAmount feePct);
     CAmount GetDexFeePct(DCT_ID poolId, DCT_ID tokenId) const;
 
+    // token -> (pool id, token on the other side), edges in pool id order
+    using PoolGraph = std::map<DCT_ID, std::vector<std::pair<DCT_ID, DCT_ID>>>;
+    // Shared across views, built on first use and dropped whenever a pool pair is created
+    std::shared_ptr<const PoolGraph> GetPoolGraph();
+
     std::pair<CAmount, CAmount> UpdatePoolRewards(std::function<CTokenAmount(CScript const &, DCT_ID)> onGetBalance, std::function<Res(CScript const &, CScript const &, CTokenAmount)> onTransfer, int nHeight = 0);
 
     // tags
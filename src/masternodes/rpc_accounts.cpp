@@ -2,6 +2,8 @@
 #include <masternodes/govvariables/attributes.h>
 #include <masternodes/mn_rpc.h>
 
+#include <queue>
+
 std::string tokenAmountString(CTokenAmount const& amount) {
     const auto token = pcustomcsview->GetToken(amount.nTokenId);
     const auto valueString = ValueFromAmount(amount.nValue).getValStr();
@@ -942,6 +944,107 @@ public:
     }
 };
 
+// symbol keys map to exactly one token, so filters can compare ids instead of symbols
+static Optional<DCT_ID> ResolveTokenFilter(CCustomCSView const & view, std::string const & tokenFilter) {
+    if (tokenFilter.empty()) {
+        return {};
+    }
+    if (auto pair = view.GetToken(tokenFilter)) {
+        return pair->first;
+    }
+    return {};
+}
+
+// Replayed rewards are computed by reverting every entry of the owner, so they always walk the full history.
+// Otherwise a category or token filter walks the matching index entries only.
+static void ForEachFilteredAccountHistory(bool replayRewards, CustomTxType txType, std::string const & tokenFilter, Optional<DCT_ID> const & tokenId,
+                                          std::function<bool(AccountHistoryKey const &, CLazySerialize<AccountHistoryValue>)> callback, AccountHistoryKey const & start) {
+    if (!replayRewards && paccountHistoryDB->HasHistoryIndexes()) {
+        if (CustomTxType::None != txType) {
+            paccountHistoryDB->ForEachAccountHistoryByType(uint8_t(txType), callback, start);
+            return;
+        }
+        if (!tokenFilter.empty()) {
+            if (tokenId) {
+                paccountHistoryDB->ForEachAccountHistoryByToken(*tokenId, callback, start);
+            }
+            return;
+        }
+    }
+    paccountHistoryDB->ForEachAccountHistory(callback, start);
+}
+
+// the reward index holds every reward of the owner from height on
+static bool HasRewardHistory(CScript const & owner, uint32_t height) {
+    auto start = paccountHistoryDB->GetRewardHistoryStart();
+    if (!start) {
+        return false;
+    }
+    if (height >= *start) {
+        return true;
+    }
+    // rewards need pool shares, an owner without older history had nothing settled before the index
+    bool olderHistory = false;
+    paccountHistoryDB->ForEachAccountHistory([&](AccountHistoryKey const & key, CLazySerialize<AccountHistoryValue>) {
+        olderHistory = key.owner == owner;
+        return false;
+    }, {owner, *start - 1, std::numeric_limits<uint32_t>::max()});
+    return !olderHistory;
+}
+
+struct RewardRange {
+    DCT_ID poolId;
+    RewardType type;
+    CTokenAmount amount; // per block
+    uint32_t begin;
+    uint32_t end;
+};
+
+// reward ranges of the owner clipped to [begin, end), settled ones from the reward index and the unsettled tail
+static std::vector<RewardRange> GetRewardRanges(CCustomCSView & view, CScript const & owner, uint32_t begin, uint32_t end) {
+    std::vector<RewardRange> ranges;
+    auto addRange = [&](DCT_ID poolId, RewardType type, CTokenAmount amount, uint32_t rangeBegin, uint32_t rangeEnd) {
+        rangeBegin = std::max(rangeBegin, begin);
+        rangeEnd = std::min(rangeEnd, end);
+        if (amount.nValue != 0 && rangeBegin < rangeEnd) {
+            ranges.push_back({poolId, type, amount, rangeBegin, rangeEnd});
+        }
+    };
+
+    // rewards since the last balance change are not settled yet
+    CCustomCSView tailView(view);
+    tailView.CalculateOwnerRewards(owner, end, addRange);
+
+    paccountHistoryDB->ForEachRewardHistory([&](RewardHistoryKey const & key, CLazySerialize<RewardHistoryValue> valueLazy) {
+        // ranges end at or below the height they were settled at
+        if (key.owner != owner || key.blockHeight <= begin) {
+            return false;
+        }
+        for (const auto& range : valueLazy.get()) {
+            addRange(key.poolID, RewardType(range.type), range.amount, range.begin, range.end);
+        }
+        return true;
+    }, {owner, std::numeric_limits<uint32_t>::max(), DCT_ID{0}});
+    return ranges;
+}
+
+// expands ranges into per block rows, newest first, up to limit rows
+static void ForEachRewardRow(std::vector<RewardRange> const & ranges, uint32_t limit, std::function<void(uint32_t, RewardRange const &)> onRow) {
+    std::priority_queue<std::pair<uint32_t, size_t>> rows;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        rows.emplace(ranges[i].end - 1, i);
+    }
+    for (; limit != 0 && !rows.empty(); --limit) {
+        const auto row = rows.top();
+        rows.pop();
+        const auto& range = ranges[row.second];
+        onRow(row.first, range);
+        if (row.first > range.begin) {
+            rows.emplace(row.first - 1, row.second);
+        }
+    }
+}
+
 UniValue listaccounthistory(const JSONRPCRequest& request) {
     auto pwallet = GetWallet(request);
 
@@ -1064,19 +1167,13 @@ UniValue listaccounthistory(const JSONRPCRequest& request) {
     std::set<uint256> txs;
     const bool shouldSearchInWallet = (tokenFilter.empty() || tokenFilter == "DFI") && CustomTxType::None == txType;
 
-    auto hasToken = [&tokenFilter](TAmounts const & diffs) {
-        for (auto const & diff : diffs) {
-            auto token = pcustomcsview->GetToken(diff.first);
-            auto const tokenIdStr = token->CreateSymbolKey(diff.first);
-            if(tokenIdStr == tokenFilter) {
-                return true;
-            }
-        }
-        return false;
-    };
-
     LOCK(cs_main);
     CCustomCSView view(*pcustomcsview);
+
+    const auto tokenId = ResolveTokenFilter(view, tokenFilter);
+    auto hasToken = [&tokenId](TAmounts const & diffs) {
+        return tokenId && diffs.count(*tokenId) != 0;
+    };
     CCoinsViewCache coins(&::ChainstateActive().CoinsTip());
     std::map<uint32_t, UniValue, std::greater<uint32_t>> ret;
 
@@ -1088,6 +1185,10 @@ UniValue listaccounthistory(const JSONRPCRequest& request) {
         return startBlock > blockHeight || blockHeight > maxBlockHeight;
     };
 
+    // rewards of a single owner come from the reward index instead of a history replay
+    const bool rewardIndex = !noRewards && !account.empty() && CustomTxType::None == txType && HasRewardHistory(account, startBlock);
+    const bool replayRewards = !noRewards && !rewardIndex;
+
     CScript lastOwner;
     auto count = limit;
     auto lastHeight = maxBlockHeight;
@@ -1098,7 +1199,7 @@ UniValue listaccounthistory(const JSONRPCRequest& request) {
         }
 
         std::unique_ptr<CScopeAccountReverter> reverter;
-        if (!noRewards) {
+        if (replayRewards) {
             reverter = MakeUnique<CScopeAccountReverter>(view, key.owner, valueLazy.get().diff);
         }
 
@@ -1107,9 +1208,12 @@ UniValue listaccounthistory(const JSONRPCRequest& request) {
 
         if (shouldSkipBlock(key.blockHeight)) {
             // show rewards in interval [startBlock, lastHeight)
-            if (!noRewards && startBlock > workingHeight) {
+            if (replayRewards && startBlock > workingHeight) {
                 accountRecord = false;
                 workingHeight = startBlock;
+            } else if (!account.empty() && startBlock > workingHeight) {
+                // remaining entries of the owner are older
+                return false;
             } else {
                 return true;
             }
@@ -1150,7 +1254,7 @@ UniValue listaccounthistory(const JSONRPCRequest& request) {
             --count;
         }
 
-        if (!noRewards && count && lastHeight > workingHeight) {
+        if (replayRewards && count && lastHeight > workingHeight) {
             onPoolRewards(view, key.owner, workingHeight, lastHeight,
                 [&](int32_t height, DCT_ID poolId, RewardType type, CTokenAmount amount) {
                     if (tokenFilter.empty() || hasToken({{amount.nTokenId, amount.nValue}})) {
@@ -1169,7 +1273,7 @@ UniValue listaccounthistory(const JSONRPCRequest& request) {
 
     AccountHistoryKey startKey{account, maxBlockHeight, txn};
 
-    if (!noRewards && !account.empty()) {
+    if (replayRewards && !account.empty()) {
         // revert previous tx to restore account balances to maxBlockHeight
         paccountHistoryDB->ForEachAccountHistory([&](AccountHistoryKey const & key, AccountHistoryValue const & value) {
             if (startKey.blockHeight > key.blockHeight) {
@@ -1183,7 +1287,21 @@ UniValue listaccounthistory(const JSONRPCRequest& request) {
         }, {account, std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max()});
     }
 
-    paccountHistoryDB->ForEachAccountHistory(shouldContinueToNextAccountHistory, startKey);
+    ForEachFilteredAccountHistory(replayRewards, txType, tokenFilter, tokenId, shouldContinueToNextAccountHistory, startKey);
+
+    if (rewardIndex) {
+        auto ranges = GetRewardRanges(view, account, startBlock, maxBlockHeight);
+        if (!tokenFilter.empty()) {
+            ranges.erase(std::remove_if(ranges.begin(), ranges.end(), [&](RewardRange const & range) {
+                return !hasToken({{range.amount.nTokenId, range.amount.nValue}});
+            }), ranges.end());
+        }
+        // rows below the first limit ones can not make it into the slice
+        ForEachRewardRow(ranges, limit, [&](uint32_t height, RewardRange const & range) {
+            auto& array = ret.emplace(height, UniValue::VARR).first->second;
+            array.push_back(rewardhistoryToJSON(account, height, range.poolId, range.type, range.amount));
+        });
+    }
 
     if (shouldSearchInWallet) {
         count = limit;
@@ -1340,19 +1458,13 @@ UniValue listburnhistory(const JSONRPCRequest& request) {
 
     std::set<uint256> txs;
 
-    auto hasToken = [&tokenFilter](TAmounts const & diffs) {
-        for (auto const & diff : diffs) {
-            auto token = pcustomcsview->GetToken(diff.first);
-            auto const tokenIdStr = token->CreateSymbolKey(diff.first);
-            if(tokenIdStr == tokenFilter) {
-                return true;
-            }
-        }
-        return false;
-    };
-
     LOCK(cs_main);
     CCustomCSView view(*pcustomcsview);
+
+    const auto tokenId = ResolveTokenFilter(view, tokenFilter);
+    auto hasToken = [&tokenId](TAmounts const & diffs) {
+        return tokenId && diffs.count(*tokenId) != 0;
+    };
     CCoinsViewCache coins(&::ChainstateActive().CoinsTip());
     std::map<uint32_t, UniValue, std::greater<uint32_t>> ret;
 
@@ -1488,19 +1600,13 @@ UniValue accounthistorycount(const JSONRPCRequest& request) {
     std::set<uint256> txs;
     const bool shouldSearchInWallet = (tokenFilter.empty() || tokenFilter == "DFI") && CustomTxType::None == txType;
 
-    auto hasToken = [&tokenFilter](TAmounts const & diffs) {
-        for (auto const & diff : diffs) {
-            auto token = pcustomcsview->GetToken(diff.first);
-            auto const tokenIdStr = token->CreateSymbolKey(diff.first);
-            if(tokenIdStr == tokenFilter) {
-                return true;
-            }
-        }
-        return false;
-    };
-
     LOCK(cs_main);
     CCustomCSView view(*pcustomcsview);
+
+    const auto tokenId = ResolveTokenFilter(view, tokenFilter);
+    auto hasToken = [&tokenId](TAmounts const & diffs) {
+        return tokenId && diffs.count(*tokenId) != 0;
+    };
     CCoinsViewCache coins(&::ChainstateActive().CoinsTip());
 
     CScript lastOwner;
@@ -1508,6 +1614,10 @@ UniValue accounthistorycount(const JSONRPCRequest& request) {
     auto lastHeight = uint32_t(::ChainActive().Height());
     const auto currentHeight = lastHeight;
 
+    // rewards of a single owner come from the reward index instead of a history replay
+    const bool rewardIndex = !noRewards && !owner.empty() && CustomTxType::None == txType && HasRewardHistory(owner, 0);
+    const bool replayRewards = !noRewards && !rewardIndex;
+
     auto shouldContinueToNextAccountHistory = [&](AccountHistoryKey const & key, CLazySerialize<AccountHistoryValue> valueLazy) -> bool {
         if (!owner.empty() && owner != key.owner) {
             return false;
@@ -1520,7 +1630,7 @@ UniValue accounthistorycount(const JSONRPCRequest& request) {
         const auto& value = valueLazy.get();
 
         std::unique_ptr<CScopeAccountReverter> reverter;
-        if (!noRewards) {
+        if (replayRewards) {
             reverter = MakeUnique<CScopeAccountReverter>(view, key.owner, value.diff);
         }
 
@@ -1535,7 +1645,7 @@ UniValue accounthistorycount(const JSONRPCRequest& request) {
             ++count;
         }
 
-        if (!noRewards) {
+        if (replayRewards) {
             // starting new account
             if (lastOwner != key.owner) {
                 view.Discard();
@@ -1556,7 +1666,15 @@ UniValue accounthistorycount(const JSONRPCRequest& request) {
     };
 
     AccountHistoryKey startAccountKey{owner, currentHeight, std::numeric_limits<uint32_t>::max()};
-    paccountHistoryDB->ForEachAccountHistory(shouldContinueToNextAccountHistory, startAccountKey);
+    ForEachFilteredAccountHistory(replayRewards, txType, tokenFilter, tokenId, shouldContinueToNextAccountHistory, startAccountKey);
+
+    if (rewardIndex) {
+        for (const auto& range : GetRewardRanges(view, owner, 0, currentHeight)) {
+            if (tokenFilter.empty() || hasToken({{range.amount.nTokenId, range.amount.nValue}})) {
+                count += range.end - range.begin;
+            }
+        }
+    }
 
     if (shouldSearchInWallet) {
         searchInWallet(pwallet, owner, filter,
@@ -1746,6 +1864,9 @@ UniValue getburninfo(const JSONRPCRequest& request) {
                "\nReturns burn address and burnt coin and token information.\n"
                "Requires full acindex for correct amount, tokens and feeburn values.\n",
                {
+                       {"height", RPCArg::Type::NUM, RPCArg::Optional::OMITTED,
+                        "Report burn history totals as of this block height. "
+                        "Governance and community balance values always reflect the current tip."},
                },
                RPCResult{
                        "{\n"
@@ -1762,6 +1883,7 @@ UniValue getburninfo(const JSONRPCRequest& request) {
                },
                RPCExamples{
                        HelpExampleCli("getburninfo", "")
+                       + HelpExampleCli("getburninfo", "1000000")
                        + HelpExampleRpc("getburninfo", "")
                },
     }.Check(request);
@@ -1777,67 +1899,31 @@ UniValue getburninfo(const JSONRPCRequest& request) {
 
     LOCK(cs_main);
 
-    auto calcBurn = [&](AccountHistoryKey const & key, CLazySerialize<AccountHistoryValue> valueLazy) -> bool
-    {
-        const auto & value = valueLazy.get();
-
-        // UTXO burn
-        if (value.category == uint8_t(CustomTxType::None)) {
-            for (auto const & diff : value.diff) {
-                burntDFI += diff.second;
-            }
-            return true;
-        }
-
-        // Fee burn
-        if (value.category == uint8_t(CustomTxType::CreateMasternode)
-        || value.category == uint8_t(CustomTxType::CreateToken)
-        || value.category == uint8_t(CustomTxType::Vault)) {
-            for (auto const & diff : value.diff) {
-                burntFee += diff.second;
-            }
-            return true;
-        }
-
-        // withdraw burn
-        if (value.category == uint8_t(CustomTxType::PaybackLoan)) {
-            for (auto const & diff : value.diff) {
-                paybackFee += diff.second;
-            }
-            return true;
-        }
-
-        // auction burn
-        if (value.category == uint8_t(CustomTxType::AuctionBid)) {
-            for (auto const & diff : value.diff) {
-                auctionFee += diff.second;
-            }
-            return true;
-        }
-
-        // dex fee burn
-        if (value.category == uint8_t(CustomTxType::PoolSwap)
-        ||  value.category == uint8_t(CustomTxType::PoolSwapV2)) {
-            for (auto const & diff : value.diff) {
-                if (pcustomcsview->GetLoanTokenByID(diff.first)) {
-                    dexfeeburn.Add({diff.first, diff.second});
-                } else {
-                    burntTokens.Add({diff.first, diff.second});
-                }
-            }
-            return true;
+    CBurnTotals totals;
+    if (request.params[0].isNull()) {
+        totals = pburnHistoryDB->GetBurnTotals();
+    } else {
+        auto height = request.params[0].get_int();
+        if (height < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "height must be non-negative");
         }
+        totals = pburnHistoryDB->GetBurnTotals(height);
+    }
 
-        // Token burn
-        for (auto const & diff : value.diff) {
+    burntDFI = totals.utxoBurn;
+    burntFee = totals.feeBurn;
+    auctionFee = totals.auctionBurn;
+    paybackFee = totals.paybackBurn;
+    for (auto const & diff : totals.dexFeeBurn) {
+        if (pcustomcsview->GetLoanTokenByID(diff.first)) {
+            dexfeeburn.Add({diff.first, diff.second});
+        } else {
             burntTokens.Add({diff.first, diff.second});
         }
-
-        return true;
-    };
-
-    AccountHistoryKey startKey{{}, std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max()};
-    pburnHistoryDB->ForEachAccountHistory(calcBurn, startKey);
+    }
+    for (auto const & diff : totals.tokenBurn) {
+        burntTokens.Add({diff.first, diff.second});
+    }
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("address", ScriptToString(Params().GetConsensus().burnAddress));
@@ -2034,7 +2120,7 @@ static const CRPCCommand commands[] =
     {"accounts",    "accounthistorycount",   &accounthistorycount,   {"owner", "options"}},
     {"accounts",    "listcommunitybalances", &listcommunitybalances, {}},
     {"accounts",    "sendtokenstoaddress",   &sendtokenstoaddress,   {"from", "to", "selectionMode"}},
-    {"accounts",    "getburninfo",           &getburninfo,           {}},
+    {"accounts",    "getburninfo",           &getburninfo,           {"height"}},
     {"accounts",    "executesmartcontract",  &executesmartcontract,  {"name", "amount", "inputs"}},
 };
 
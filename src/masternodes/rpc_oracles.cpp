@@ -813,36 +813,39 @@ UniValue listlatestrawprices(const JSONRPCRequest &request) {
     return result;
 }
 
-ResVal<CAmount> GetAggregatePrice(CCustomCSView& view, const std::string& token, const std::string& currency, uint64_t lastBlockTime) {
+static ResVal<CAmount> GetAggregatePrice(CCustomCSView& view, const std::string& token, const std::string& currency, uint64_t lastBlockTime, std::map<COracleId, COracle>& oracles) {
     // DUSD-USD always returns 1.00000000
     if (token == "DUSD" && currency == "USD") {
         return ResVal<CAmount>(COIN, Res::Ok());
     }
     arith_uint256 weightedSum = 0;
     uint64_t numLiveOracles = 0, sumWeights = 0;
-    view.ForEachOracle([&](const COracleId&, COracle oracle) {
-        if (!oracle.SupportsPair(token, currency)) {
+    view.ForEachOracleByPair({token, currency}, [&](const COracleId& oracleId) {
+        auto it = oracles.find(oracleId);
+        if (it == oracles.end()) {
+            auto oracle = view.GetOracleData(oracleId);
+            if (!oracle) {
+                return true;
+            }
+            it = oracles.emplace(oracleId, std::move(*oracle.val)).first;
+        }
+        const auto& oracle = it->second;
+        auto tokenPrice = oracle.tokenPrices.find(token);
+        if (tokenPrice == oracle.tokenPrices.end()) {
             return true;
         }
-        for (const auto& tokenPrice : oracle.tokenPrices) {
-            if (token != tokenPrice.first) {
-                continue;
-            }
-            for (const auto& price : tokenPrice.second) {
-                if (currency != price.first) {
-                    continue;
-                }
-                const auto& pricePair = price.second;
-                auto amount = pricePair.first;
-                auto timestamp = pricePair.second;
-                if (!diffInHour(timestamp, lastBlockTime)) {
-                    continue;
-                }
-                ++numLiveOracles;
-                sumWeights += oracle.weightage;
-                weightedSum += arith_uint256(amount) * arith_uint256(oracle.weightage);
-            }
+        auto price = tokenPrice->second.find(currency);
+        if (price == tokenPrice->second.end()) {
+            return true;
         }
+        auto amount = price->second.first;
+        auto timestamp = price->second.second;
+        if (!diffInHour(timestamp, lastBlockTime)) {
+            return true;
+        }
+        ++numLiveOracles;
+        sumWeights += oracle.weightage;
+        weightedSum += arith_uint256(amount) * arith_uint256(oracle.weightage);
         return true;
     });
 
@@ -861,6 +864,21 @@ ResVal<CAmount> GetAggregatePrice(CCustomCSView& view, const std::string& token,
     return res;
 }
 
+ResVal<CAmount> GetAggregatePrice(CCustomCSView& view, const std::string& token, const std::string& currency, uint64_t lastBlockTime) {
+    std::map<COracleId, COracle> oracles;
+    return GetAggregatePrice(view, token, currency, lastBlockTime, oracles);
+}
+
+std::map<CTokenCurrencyPair, ResVal<CAmount>> GetAggregatePrices(CCustomCSView& view, const std::set<CTokenCurrencyPair>& pairs, uint64_t lastBlockTime) {
+    // each oracle is read once, however many of the requested pairs it feeds
+    std::map<COracleId, COracle> oracles;
+    std::map<CTokenCurrencyPair, ResVal<CAmount>> result;
+    for (const auto& pair : pairs) {
+        result.emplace(pair, GetAggregatePrice(view, pair.first, pair.second, lastBlockTime, oracles));
+    }
+    return result;
+}
+
 namespace {
 
     UniValue GetAllAggregatePrices(CCustomCSView& view, uint64_t lastBlockTime, const UniValue& paginationObj) {
@@ -898,13 +916,14 @@ namespace {
             setTokenCurrency.insert(startingPairIt, pairs.end());
             return true;
         });
+        std::map<COracleId, COracle> oracles;
         for (const auto& tokenCurrency : setTokenCurrency) {
             UniValue item{UniValue::VOBJ};
             const auto& token = tokenCurrency.first;
             const auto& currency = tokenCurrency.second;
             item.pushKV(oraclefields::Token, token);
             item.pushKV(oraclefields::Currency, currency);
-            auto aggregatePrice = GetAggregatePrice(view, token, currency, lastBlockTime);
+            auto aggregatePrice = GetAggregatePrice(view, token, currency, lastBlockTime, oracles);
             if (aggregatePrice) {
                 item.pushKV(oraclefields::AggregatedPrice, ValueFromAmount(*aggregatePrice.val));
                 item.pushKV(oraclefields::ValidityFlag, oraclefields::FlagIsValid);
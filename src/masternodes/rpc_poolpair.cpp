@@ -104,9 +104,8 @@ UniValue poolPathsToJSON(std::vector<std::vector<DCT_ID>> & poolPaths) {
     }
     return paths;
 }
-void CheckAndFillPoolSwapMessage(const JSONRPCRequest& request, CPoolSwapMessage &poolSwapMsg) {
+static void FillPoolSwapMessage(CCustomCSView& view, const UniValue& metadataObj, CPoolSwapMessage &poolSwapMsg) {
     std::string tokenFrom, tokenTo;
-    UniValue metadataObj = request.params[0].get_obj();
     if (!metadataObj["from"].isNull()) {
         poolSwapMsg.from = DecodeScript(metadataObj["from"].getValStr());
     }
@@ -122,26 +121,40 @@ void CheckAndFillPoolSwapMessage(const JSONRPCRequest& request, CPoolSwapMessage
     if (!metadataObj["tokenTo"].isNull()) {
         tokenTo = metadataObj["tokenTo"].getValStr();
     }
-    {
-        LOCK(cs_main);
-        auto token = pcustomcsview->GetTokenGuessId(tokenFrom, poolSwapMsg.idTokenFrom);
-        if (!token)
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "TokenFrom was not found");
 
-        auto token2 = pcustomcsview->GetTokenGuessId(tokenTo, poolSwapMsg.idTokenTo);
-        if (!token2)
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "TokenTo was not found");
+    auto token = view.GetTokenGuessId(tokenFrom, poolSwapMsg.idTokenFrom);
+    if (!token)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "TokenFrom was not found");
+
+    auto token2 = view.GetTokenGuessId(tokenTo, poolSwapMsg.idTokenTo);
+    if (!token2)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "TokenTo was not found");
+
+    if (!metadataObj["maxPrice"].isNull()) {
+        CAmount maxPrice = AmountFromValue(metadataObj["maxPrice"]);
+        poolSwapMsg.maxPrice.integer = maxPrice / COIN;
+        poolSwapMsg.maxPrice.fraction = maxPrice % COIN;
+    } else {
+        // There is no maxPrice calculation anymore
+        poolSwapMsg.maxPrice.integer = std::numeric_limits<CAmount>::max();
+        poolSwapMsg.maxPrice.fraction = std::numeric_limits<CAmount>::max();
+    }
+}
 
-        if (!metadataObj["maxPrice"].isNull()) {
-            CAmount maxPrice = AmountFromValue(metadataObj["maxPrice"]);
-            poolSwapMsg.maxPrice.integer = maxPrice / COIN;
-            poolSwapMsg.maxPrice.fraction = maxPrice % COIN;
-        } else {
-            // There is no maxPrice calculation anymore
-            poolSwapMsg.maxPrice.integer = std::numeric_limits<CAmount>::max();
-            poolSwapMsg.maxPrice.fraction = std::numeric_limits<CAmount>::max();
-        }
+void CheckAndFillPoolSwapMessage(const JSONRPCRequest& request, CPoolSwapMessage &poolSwapMsg) {
+    LOCK(cs_main);
+    FillPoolSwapMessage(*pcustomcsview, request.params[0].get_obj(), poolSwapMsg);
+}
+
+static std::string PoolSwapErrors(const std::string& errorMsg, const CPoolSwap& poolSwap) {
+    if (poolSwap.errors.empty()) {
+        return errorMsg;
     }
+    std::string result = errorMsg + " Details: (";
+    for (size_t i{0}; i < poolSwap.errors.size(); ++i) {
+        result += '"' + poolSwap.errors[i].first + "\":\"" +  poolSwap.errors[i].second + '"' + (i + 1 < poolSwap.errors.size() ? "," : "");
+    }
+    return result + ')';
 }
 
 UniValue listpoolpairs(const JSONRPCRequest& request) {
@@ -1141,6 +1154,139 @@ UniValue testpoolswap(const JSONRPCRequest& request) {
     return res.msg;
 }
 
+UniValue testpoolswaps(const JSONRPCRequest& request) {
+
+    RPCHelpMan{"testpoolswaps",
+               "\nTests many poolswaps against the same chain state and returns the result of each.\n"
+               "Swaps do not affect each other, pool reserves and dex fees are read once for the whole batch.\n",
+               {
+                   {"swaps", RPCArg::Type::ARR, RPCArg::Optional::NO, "",
+                       {
+                           {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
+                               {
+                                   {"from", RPCArg::Type::STR, RPCArg::Optional::NO,
+                                               "Address of the owner of tokenA."},
+                                   {"tokenFrom", RPCArg::Type::STR, RPCArg::Optional::NO,
+                                               "One of the keys may be specified (id/symbol)"},
+                                   {"amountFrom", RPCArg::Type::NUM, RPCArg::Optional::NO,
+                                               "tokenFrom coins amount"},
+                                   {"to", RPCArg::Type::STR, RPCArg::Optional::NO,
+                                               "Address of the owner of tokenB."},
+                                   {"tokenTo", RPCArg::Type::STR, RPCArg::Optional::NO,
+                                               "One of the keys may be specified (id/symbol)"},
+                                   {"maxPrice", RPCArg::Type::NUM, RPCArg::Optional::OMITTED,
+                                               "Maximum acceptable price"},
+                                   {"path", RPCArg::Type::STR, RPCArg::Optional::OMITTED,
+                                               "One of auto/direct/composite or array of pool IDs (default = auto)"},
+                               },
+                           },
+                       },
+                   },
+               },
+               RPCResult{
+                          "[                       (array) Results in request order\n"
+                          "  {\n"
+                          "    \"path\": \"auto\",        (string) Path mode used\n"
+                          "    \"pools\": [...],        (array) Pool IDs of the best path\n"
+                          "    \"amount\": \"x@id\",      (string) Amount result of poolswap in format AMOUNT@TOKENID\n"
+                          "    \"error\": \"...\",        (string) Set instead when the swap fails\n"
+                          "  },...\n"
+                          "]\n"
+               },
+               RPCExamples{
+                    HelpExampleCli("testpoolswaps", "'[{\"from\":\"MyAddress\","
+                                                    "\"tokenFrom\":\"MyToken1\","
+                                                    "\"amountFrom\":\"0.001\","
+                                                    "\"to\":\"Address\","
+                                                    "\"tokenTo\":\"Token2\","
+                                                    "\"path\":\"auto\""
+                                                    "}]'")
+                    + HelpExampleRpc("testpoolswaps", "'[{\"from\":\"MyAddress\","
+                                                    "\"tokenFrom\":\"MyToken1\","
+                                                    "\"amountFrom\":\"0.001\","
+                                                    "\"to\":\"Address\","
+                                                    "\"tokenTo\":\"Token2\","
+                                                    "\"path\":\"auto\""
+                                                    "}]'")
+               },
+    }.Check(request);
+
+    RPCTypeCheck(request.params, {UniValue::VARR}, false);
+
+    UniValue results{UniValue::VARR};
+
+    LOCK(cs_main);
+    CCustomCSView mnview_dummy(*pcustomcsview);
+    int targetHeight = ::ChainActive().Height() + 1;
+    CPoolSwapCache cache;
+
+    for (const auto& metadata : request.params[0].get_array().getValues()) {
+        UniValue result{UniValue::VOBJ};
+        try {
+            CPoolSwapMessage poolSwapMsg{};
+            FillPoolSwapMessage(mnview_dummy, metadata.get_obj(), poolSwapMsg);
+
+            std::string path = "auto";
+            if (!metadata["path"].isNull() && !metadata["path"].isArray()) {
+                path = metadata["path"].getValStr();
+            }
+
+            auto poolSwap = CPoolSwap(poolSwapMsg, targetHeight);
+            auto poolPair = mnview_dummy.GetPoolPair(poolSwapMsg.idTokenFrom, poolSwapMsg.idTokenTo);
+            if (poolPair && path == "auto") path = "direct";
+
+            std::vector<DCT_ID> poolIds;
+            if (path == "direct") {
+                if (!poolPair)
+                    throw JSONRPCError(RPC_INVALID_REQUEST, std::string{"Direct pool pair not found. Use 'auto' mode to use composite swap."});
+            } else if (path == "auto" || path == "composite") {
+                poolIds = poolSwap.CalculateSwaps(mnview_dummy, true, MAX_POOLSWAP_POOLS, &cache);
+                if (poolIds.empty())
+                    throw JSONRPCError(RPC_INVALID_REQUEST, PoolSwapErrors("Cannot find usable pool pair.", poolSwap));
+            } else {
+                path = "custom";
+
+                UniValue poolArray(UniValue::VARR);
+                if (metadata["path"].isArray()) {
+                    poolArray = metadata["path"].get_array();
+                } else {
+                    poolArray.read(metadata["path"].getValStr().c_str());
+                }
+
+                for (const auto& id : poolArray.getValues()) {
+                    poolIds.push_back(DCT_ID::FromString(id.getValStr()));
+                }
+
+                auto availablePaths = poolSwap.CalculatePoolPaths(mnview_dummy);
+                if (std::find(availablePaths.begin(), availablePaths.end(), poolIds) == availablePaths.end())
+                    throw JSONRPCError(RPC_INVALID_REQUEST, "Custom pool path is invalid.");
+            }
+
+            auto res = poolSwap.SimulateSwap(mnview_dummy, poolIds, cache);
+            if (!res)
+                throw JSONRPCError(RPC_VERIFY_ERROR, PoolSwapErrors(res.msg, poolSwap));
+
+            UniValue pools{UniValue::VARR};
+            if (poolIds.empty()) {
+                pools.push_back(poolPair->first.ToString());
+            }
+            for (const auto& id : poolIds) {
+                pools.push_back(id.ToString());
+            }
+            result.pushKV("path", path);
+            result.pushKV("pools", pools);
+            result.pushKV("amount", CTokenAmount{poolSwapMsg.idTokenTo, *res.val}.ToString());
+        } catch (const UniValue& objError) {
+            result.pushKV("error", find_value(objError, "message").getValStr());
+        } catch (const std::exception& e) {
+            result.pushKV("error", e.what());
+        }
+        results.push_back(result);
+    }
+
+    return results;
+}
+
 UniValue listpoolshares(const JSONRPCRequest& request) {
     RPCHelpMan{"listpoolshares",
                "\nReturns information about pool shares.\n",
@@ -1251,6 +1397,7 @@ static const CRPCCommand commands[] =
     {"poolpair",    "compositeswap",            &compositeswap,             {"metadata", "inputs"}},
     {"poolpair",    "listpoolshares",           &listpoolshares,            {"pagination", "verbose", "is_mine_only"}},
     {"poolpair",    "testpoolswap",             &testpoolswap,              {"metadata", "path", "verbose"}},
+    {"poolpair",    "testpoolswaps",            &testpoolswaps,             {"swaps"}},
 };
 
 void RegisterPoolpairRPCCommands(CRPCTable& tableRPC) {
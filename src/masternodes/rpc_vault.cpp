@@ -49,6 +49,10 @@ namespace {
         if (!collaterals)
             return false;
 
+        // without loans the ratio is unbounded
+        if (!pcustomcsview->GetLoanTokens(vaultId))
+            return false;
+
         bool useNextPrice = true, requireLivePrice = false;
         auto vaultRate = pcustomcsview->GetLoanCollaterals(vaultId, *collaterals, height, blockTime, useNextPrice, requireLivePrice);
         if (!vaultRate)
@@ -76,6 +80,40 @@ namespace {
         return VaultState::Unknown;
     }
 
+    // State recorded at the last collateralization ratio calculation, unevaluated vaults are evaluated now
+    VaultState GetIndexedVaultState(const CVaultId& vaultId, const CVaultData& vault, const boost::optional<CVaultRatio>& ratio) {
+        if (ratio && !vault.isUnderLiquidation) {
+            switch (VaultRatioState(ratio->state)) {
+                case VaultRatioState::Active:
+                    return VaultState::Active;
+                case VaultRatioState::MayLiquidate:
+                    return VaultState::MayLiquidate;
+                case VaultRatioState::Frozen:
+                    return VaultState::Frozen;
+                case VaultRatioState::InLiquidation:
+                case VaultRatioState::Unevaluated:
+                    break;
+            }
+        }
+        return GetVaultState(vaultId, vault);
+    }
+
+    VaultRatioState ToVaultRatioState(const VaultState& state) {
+        switch (state) {
+            case VaultState::Active:
+                return VaultRatioState::Active;
+            case VaultState::MayLiquidate:
+                return VaultRatioState::MayLiquidate;
+            case VaultState::Frozen:
+                return VaultRatioState::Frozen;
+            case VaultState::InLiquidation:
+                return VaultRatioState::InLiquidation;
+            case VaultState::Unknown:
+                break;
+        }
+        return VaultRatioState::Unevaluated;
+    }
+
     UniValue BatchToJSON(const CVaultId& vaultId, uint32_t batchCount) {
         UniValue batchArray{UniValue::VARR};
         for (uint32_t i = 0; i < batchCount; i++) {
@@ -109,9 +147,9 @@ namespace {
         return auctionObj;
     }
 
-    UniValue VaultToJSON(const CVaultId& vaultId, const CVaultData& vault) {
+    UniValue VaultToJSON(const CVaultId& vaultId, const CVaultData& vault, const boost::optional<CVaultRatio>& ratio = {}) {
         UniValue result{UniValue::VOBJ};
-        auto vaultState = GetVaultState(vaultId, vault);
+        auto vaultState = GetIndexedVaultState(vaultId, vault, ratio);
         auto height = ::ChainActive().Height();
 
         if (vaultState == VaultState::InLiquidation) {
@@ -129,10 +167,18 @@ namespace {
         if (!collaterals)
             collaterals = CBalances{};
 
-        auto blockTime = ::ChainActive().Tip()->GetBlockTime();
-        bool useNextPrice = false, requireLivePrice = vaultState != VaultState::Frozen;
-        LogPrint(BCLog::LOAN,"%s():\n", __func__);
-        auto rate = pcustomcsview->GetLoanCollaterals(vaultId, *collaterals, height + 1, blockTime, useNextPrice, requireLivePrice);
+        ResVal<CCollateralLoans> rate = Res::Err("Vault not valued");
+        if (ratio && ratio->state != uint8_t(VaultRatioState::Unevaluated)) {
+            CCollateralLoans cached{};
+            cached.totalCollaterals = ratio->totalCollaterals;
+            cached.totalLoans = ratio->totalLoans;
+            rate = ResVal<CCollateralLoans>(cached, Res::Ok());
+        } else {
+            auto blockTime = ::ChainActive().Tip()->GetBlockTime();
+            bool useNextPrice = false, requireLivePrice = vaultState != VaultState::Frozen;
+            LogPrint(BCLog::LOAN,"%s():\n", __func__);
+            rate = pcustomcsview->GetLoanCollaterals(vaultId, *collaterals, height + 1, blockTime, useNextPrice, requireLivePrice);
+        }
 
         if (rate) {
             collValue = ValueFromUint(rate.val->totalCollaterals);
@@ -371,7 +417,9 @@ UniValue closevault(const JSONRPCRequest& request) {
 UniValue listvaults(const JSONRPCRequest& request) {
 
     RPCHelpMan{"listvaults",
-               "List all available vaults.\n",
+               "List all available vaults.\n"
+               "States and values of vaults with loans are those of the last collateralization ratio calculation,\n"
+               "vaults changed since then are evaluated at the current block.\n",
                {
                     {
                        "options", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
@@ -477,7 +525,21 @@ UniValue listvaults(const JSONRPCRequest& request) {
 
     LOCK(cs_main);
 
-    pcustomcsview->ForEachVault([&](const CVaultId& vaultId, const CVaultData& data) {
+    auto pushVault = [&](const CVaultId& vaultId, const CVaultData& data, const boost::optional<CVaultRatio>& ratio, VaultState vaultState) {
+        UniValue vaultObj{UniValue::VOBJ};
+        if(!verbose){
+            vaultObj.pushKV("vaultId", vaultId.GetHex());
+            vaultObj.pushKV("ownerAddress", ScriptToString(data.ownerAddress));
+            vaultObj.pushKV("loanSchemeId", data.schemeId);
+            vaultObj.pushKV("state", VaultStateToString(vaultState));
+        } else {
+            vaultObj = VaultToJSON(vaultId, data, ratio);
+        }
+        valueArr.push_back(vaultObj);
+        limit--;
+    };
+
+    auto filterVault = [&](const CVaultId& vaultId, const CVaultData& data) {
         if (!including_start)
         {
             including_start = true;
@@ -486,24 +548,61 @@ UniValue listvaults(const JSONRPCRequest& request) {
         if (!ownerAddress.empty() && ownerAddress != data.ownerAddress) {
             return false;
         }
-        auto vaultState = GetVaultState(vaultId, data);
-
-        if ((loanSchemeId.empty() || loanSchemeId == data.schemeId)
-        && (state == VaultState::Unknown || state == vaultState)) {
-            UniValue vaultObj{UniValue::VOBJ};
-            if(!verbose){
-                vaultObj.pushKV("vaultId", vaultId.GetHex());
-                vaultObj.pushKV("ownerAddress", ScriptToString(data.ownerAddress));
-                vaultObj.pushKV("loanSchemeId", data.schemeId);
-                vaultObj.pushKV("state", VaultStateToString(vaultState));
-            } else {
-                vaultObj = VaultToJSON(vaultId, data);
-            }
-            valueArr.push_back(vaultObj);
-            limit--;
+        if (!loanSchemeId.empty() && loanSchemeId != data.schemeId) {
+            return true;
+        }
+        auto ratio = pcustomcsview->GetVaultRatio(vaultId);
+        auto vaultState = GetIndexedVaultState(vaultId, data, ratio);
+        if (state == VaultState::Unknown || state == vaultState) {
+            pushVault(vaultId, data, ratio, vaultState);
         }
         return limit != 0;
-    }, start, ownerAddress);
+    };
+
+    if (!ownerAddress.empty() || (loanSchemeId.empty() && state == VaultState::Unknown)) {
+        pcustomcsview->ForEachVault(filterVault, start, ownerAddress);
+    } else if (!loanSchemeId.empty()) {
+        pcustomcsview->ForEachVaultByScheme(filterVault, loanSchemeId, start);
+    } else {
+        // Vaults changed since the last ratio calculation are merged in by id, evaluated now
+        std::vector<std::pair<CVaultId, CVaultData>> unevaluated;
+        if (state != VaultState::InLiquidation) {
+            pcustomcsview->ForEachVaultByState([&](const CVaultId& vaultId, const CVaultRatio&) {
+                auto vault = pcustomcsview->GetVault(vaultId);
+                if (vault && GetVaultState(vaultId, *vault) == state) {
+                    unevaluated.emplace_back(vaultId, std::move(*vault));
+                }
+                return true;
+            }, VaultRatioState::Unevaluated, start);
+        }
+        auto pending = unevaluated.begin();
+
+        auto visit = [&](const CVaultId& vaultId, const CVaultData& data, const boost::optional<CVaultRatio>& ratio) {
+            if (!including_start) {
+                including_start = true;
+                return true;
+            }
+            pushVault(vaultId, data, ratio, state);
+            return limit != 0;
+        };
+
+        pcustomcsview->ForEachVaultByState([&](const CVaultId& vaultId, const CVaultRatio& ratio) {
+            for (; pending != unevaluated.end() && pending->first < vaultId; ++pending) {
+                if (!visit(pending->first, pending->second, {})) {
+                    return false;
+                }
+            }
+            auto vault = pcustomcsview->GetVault(vaultId);
+            if (!vault || GetIndexedVaultState(vaultId, *vault, ratio) != state) {
+                return true;
+            }
+            return visit(vaultId, *vault, ratio);
+        }, ToVaultRatioState(state), start);
+
+        for (; limit != 0 && pending != unevaluated.end(); ++pending) {
+            visit(pending->first, pending->second, {});
+        }
+    }
 
     return valueArr;
 }
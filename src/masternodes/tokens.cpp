@@ -28,7 +28,7 @@ std::string trim_ws(std::string const & str)
 
 std::unique_ptr<CToken> CTokensView::GetToken(DCT_ID id) const
 {
-    if (auto tokenImpl = ReadBy<ID, CTokenImpl>(id)) {
+    if (auto tokenImpl = ReadCachedBy<ID, CTokenImpl>(id)) {
         return MakeUnique<CTokenImpl>(*tokenImpl);
     }
 
@@ -48,7 +48,7 @@ boost::optional<std::pair<DCT_ID, CTokensView::CTokenImpl> > CTokensView::GetTok
 {
     DCT_ID id;
     if (ReadBy<CreationTx, uint256>(txid, id)) {
-        if (auto tokenImpl = ReadBy<ID, CTokenImpl>(id)) {
+        if (auto tokenImpl = ReadCachedBy<ID, CTokenImpl>(id)) {
             return std::make_pair(id, std::move(*tokenImpl));
         }
     }
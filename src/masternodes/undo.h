@@ -26,17 +26,51 @@ struct UndoKey {
 };
 
 struct CUndo {
-    MapKV before;
+    std::map<TBytes, Optional<TBytes>> before;
 
-    static CUndo Construct(CStorageKV const & before, MapKV const & diff) {
+    // diff is ordered, so a single forward iterator over the previous state answers every key,
+    // it only seeks when the key is past its position and results are appended in order
+    static CUndo Construct(CStorageKV & before, MapKV const & diff) {
         CUndo result;
+        if (diff.empty()) {
+            return result;
+        }
+        // a seek counts as reading its whole prefix, tracking is paused and the keys are recorded as point reads would.
+        // Untracked layers are left alone, they may be shared with custom txs applied on other threads.
+        std::vector<std::pair<CFlushableStorageKV*, CStorageReadSet*>> layers;
+        bool tracked = false;
+        for (auto layer = dynamic_cast<CFlushableStorageKV*>(&before); layer; layer = dynamic_cast<CFlushableStorageKV*>(&layer->GetParent())) {
+            layers.emplace_back(layer, layer->GetReadSet());
+            if (layers.back().second) {
+                tracked = true;
+                layer->TrackReads(nullptr);
+            }
+        }
+        auto it = before.NewIterator();
+        TBytes key;
         for (const auto & kv : diff) {
-            const auto& beforeKey = kv.first;
-            TBytes beforeVal;
-            if (before.Read(beforeKey, beforeVal)) {
-                result.before[beforeKey] = std::move(beforeVal);
-            } else {
-                result.before[beforeKey] = {};
+            key.assign(kv.first.begin(), kv.first.end());
+            if (!it->Valid() || CompareBytes(it->Key(), kv.first) < 0) {
+                it->Seek(key);
+            }
+            Optional<TBytes> value;
+            if (it->Valid() && CompareBytes(it->Key(), kv.first) == 0) {
+                auto bytes = it->Value();
+                value = TBytes(bytes.begin(), bytes.end());
+            }
+            for (const auto & layer : layers) {
+                if (!tracked || layer.first->GetRaw().count(kv.first)) {
+                    break;
+                }
+                if (layer.second) {
+                    layer.second->keys.insert(key);
+                }
+            }
+            result.before.emplace_hint(result.before.end(), std::move(key), std::move(value));
+        }
+        for (const auto & layer : layers) {
+            if (layer.second) {
+                layer.first->TrackReads(layer.second);
             }
         }
         return result;
@@ -60,5 +94,72 @@ struct CUndo {
     }
 };
 
+struct BlockUndoKey {
+    uint32_t height;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(WrapBigEndian(height));
+    }
+};
+
+// Undo of every custom tx of a block in a single record, zero hash holds the block level changes.
+// Keys are stored as the length shared with the previous key plus the differing tail,
+// as consecutive keys mostly repeat the table prefix and owner script.
+struct CBlockCustomUndo {
+    std::map<uint256, CUndo> txs;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        WriteCompactSize(s, txs.size());
+        const TBytes* prevKey = nullptr;
+        for (const auto& tx : txs) {
+            s << tx.first;
+            WriteCompactSize(s, tx.second.before.size());
+            for (const auto& kv : tx.second.before) {
+                const auto& key = kv.first;
+                size_t shared = 0;
+                if (prevKey) {
+                    const auto limit = std::min(prevKey->size(), key.size());
+                    while (shared < limit && (*prevKey)[shared] == key[shared]) {
+                        ++shared;
+                    }
+                }
+                WriteCompactSize(s, shared);
+                WriteCompactSize(s, key.size() - shared);
+                s.write((const char*)key.data() + shared, key.size() - shared);
+                ::Serialize(s, kv.second);
+                prevKey = &key;
+            }
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        txs.clear();
+        TBytes prevKey;
+        for (auto txCount = ReadCompactSize(s); txCount > 0; --txCount) {
+            uint256 txid;
+            s >> txid;
+            auto& before = txs[txid].before;
+            for (auto keyCount = ReadCompactSize(s); keyCount > 0; --keyCount) {
+                const auto shared = ReadCompactSize(s);
+                if (shared > prevKey.size()) {
+                    throw std::ios_base::failure("CBlockCustomUndo: shared key prefix out of range");
+                }
+                TBytes key(prevKey.begin(), prevKey.begin() + shared);
+                key.resize(shared + ReadCompactSize(s));
+                s.read((char*)key.data() + shared, key.size() - shared);
+                Optional<TBytes> value;
+                ::Unserialize(s, value);
+                prevKey = key;
+                before.emplace(std::move(key), std::move(value));
+            }
+        }
+    }
+};
+
 
 #endif //DEFI_MASTERNODES_UNDO_H
@@ -30,3 +30,60 @@ boost::optional<CUndo> CUndosView::GetUndo(UndoKey const & key) const
     }
     return {};
 }
+
+void CUndosView::ForEachBlockUndo(std::function<bool(BlockUndoKey const &, CLazySerialize<CBlockCustomUndo>)> callback, BlockUndoKey const & start)
+{
+    ForEach<ByBlockUndo, BlockUndoKey, CBlockCustomUndo>(callback, start);
+}
+
+boost::optional<CBlockCustomUndo> CUndosView::GetBlockUndo(uint32_t height) const
+{
+    return ReadBy<ByBlockUndo, CBlockCustomUndo>(BlockUndoKey{height});
+}
+
+Res CUndosView::SetBlockUndo(uint32_t height, CBlockCustomUndo const & undo)
+{
+    WriteBy<ByBlockUndo>(BlockUndoKey{height}, undo);
+    return Res::Ok();
+}
+
+Res CUndosView::DelBlockUndo(uint32_t height)
+{
+    EraseBy<ByBlockUndo>(BlockUndoKey{height});
+    return Res::Ok();
+}
+
+size_t CUndosView::PruneUndos(uint32_t height, uint32_t maxBlocks)
+{
+    std::vector<UndoKey> undos;
+    uint32_t blocks = 0;
+    ForEachUndo([&](UndoKey const & key, CLazySerialize<CUndo>) {
+        if (key.height >= height) {
+            return false;
+        }
+        if (undos.empty() || undos.back().height != key.height) {
+            if (++blocks > maxBlocks) {
+                return false;
+            }
+        }
+        undos.push_back(key);
+        return true;
+    });
+
+    std::vector<uint32_t> blockUndos;
+    ForEachBlockUndo([&](BlockUndoKey const & key, CLazySerialize<CBlockCustomUndo>) {
+        if (key.height >= height || blockUndos.size() >= maxBlocks) {
+            return false;
+        }
+        blockUndos.push_back(key.height);
+        return true;
+    });
+
+    for (const auto& key : undos) {
+        DelUndo(key);
+    }
+    for (const auto& blockHeight : blockUndos) {
+        DelBlockUndo(blockHeight);
+    }
+    return undos.size() + blockUndos.size();
+}
@@ -17,8 +17,18 @@ public:
     Res SetUndo(UndoKey const & key, CUndo const & undo);
     Res DelUndo(UndoKey const & key);
 
+    void ForEachBlockUndo(std::function<bool(BlockUndoKey const &, CLazySerialize<CBlockCustomUndo>)> callback, BlockUndoKey const & start = {});
+
+    boost::optional<CBlockCustomUndo> GetBlockUndo(uint32_t height) const;
+    Res SetBlockUndo(uint32_t height, CBlockCustomUndo const & undo);
+    Res DelBlockUndo(uint32_t height);
+
+    // erases undo data of at most maxBlocks oldest heights below height, returns the number of records erased
+    size_t PruneUndos(uint32_t height, uint32_t maxBlocks);
+
     // tags
     struct ByUndoKey { static constexpr uint8_t prefix() { return 'u'; } };
+    struct ByBlockUndo { static constexpr uint8_t prefix() { return 's'; } };
 };
 
 
@@ -18,8 +18,22 @@ struct CAuctionKey {
 
 Res CVaultView::StoreVault(const CVaultId& vaultId, const CVaultData& vault)
 {
+    auto prev = GetVault(vaultId);
+    if (prev && prev->ownerAddress != vault.ownerAddress) {
+        EraseBy<OwnerVaultKey>(std::make_pair(prev->ownerAddress, vaultId));
+    }
+    if (prev && prev->schemeId != vault.schemeId) {
+        EraseBy<SchemeVaultKey>(std::make_pair(prev->schemeId, vaultId));
+    }
     WriteBy<VaultKey>(vaultId, vault);
     WriteBy<OwnerVaultKey>(std::make_pair(vault.ownerAddress, vaultId), '\0');
+    WriteBy<SchemeVaultKey>(std::make_pair(vault.schemeId, vaultId), '\0');
+
+    // a new scheme or liquidation status invalidates the last ratio calculation
+    if (!prev || prev->schemeId != vault.schemeId || prev->isUnderLiquidation != vault.isUnderLiquidation) {
+        auto state = vault.isUnderLiquidation ? VaultRatioState::InLiquidation : VaultRatioState::Unevaluated;
+        SetVaultRatio(vaultId, CVaultRatio{uint8_t(state), 0, 0, 0});
+    }
     return Res::Ok();
 }
 
@@ -32,6 +46,11 @@ Res CVaultView::EraseVault(const CVaultId& vaultId)
     EraseBy<VaultKey>(vaultId);
     EraseBy<CollateralKey>(vaultId);
     EraseBy<OwnerVaultKey>(std::make_pair(vault->ownerAddress, vaultId));
+    EraseBy<SchemeVaultKey>(std::make_pair(vault->schemeId, vaultId));
+    if (auto ratio = GetVaultRatio(vaultId)) {
+        EraseBy<VaultStateKey>(std::make_pair(ratio->state, vaultId));
+        EraseBy<VaultRatioKey>(vaultId);
+    }
     return Res::Ok();
 }
 
@@ -47,8 +66,6 @@ Res CVaultView::UpdateVault(const CVaultId& vaultId, const CVaultMessage& newVau
         return Res::Err("Vault <%s> not found", vaultId.GetHex());
     }
 
-    EraseBy<OwnerVaultKey>(std::make_pair(vault->ownerAddress, vaultId));
-
     vault->ownerAddress = newVault.ownerAddress;
     vault->schemeId = newVault.schemeId;
 
@@ -66,6 +83,78 @@ void CVaultView::ForEachVault(std::function<bool(const CVaultId&, const CVaultDa
     }
 }
 
+void CVaultView::ForEachVaultByScheme(std::function<bool(const CVaultId&, const CVaultData&)> callback, const std::string& schemeId, const CVaultId& start)
+{
+    ForEach<SchemeVaultKey, std::pair<std::string, CVaultId>, char>([&](const std::pair<std::string, CVaultId>& key, const char) {
+        if (key.first != schemeId) {
+            return false;
+        }
+        auto vault = GetVault(key.second);
+        if (!vault || vault->schemeId != schemeId) {
+            return true;
+        }
+        return callback(key.second, *vault);
+    }, std::make_pair(schemeId, start));
+}
+
+boost::optional<CVaultRatio> CVaultView::GetVaultRatio(const CVaultId& vaultId) const
+{
+    return ReadBy<VaultRatioKey, CVaultRatio>(vaultId);
+}
+
+void CVaultView::SetVaultRatio(const CVaultId& vaultId, const CVaultRatio& ratio)
+{
+    auto prev = GetVaultRatio(vaultId);
+    if (!prev || prev->state != ratio.state) {
+        if (prev) {
+            EraseBy<VaultStateKey>(std::make_pair(prev->state, vaultId));
+        }
+        WriteBy<VaultStateKey>(std::make_pair(ratio.state, vaultId), '\0');
+    }
+    WriteBy<VaultRatioKey>(vaultId, ratio);
+}
+
+void CVaultView::MarkVaultChanged(const CVaultId& vaultId)
+{
+    auto ratio = GetVaultRatio(vaultId);
+    if (ratio && (ratio->state == uint8_t(VaultRatioState::Unevaluated) || ratio->state == uint8_t(VaultRatioState::InLiquidation))) {
+        return;
+    }
+    SetVaultRatio(vaultId, CVaultRatio{uint8_t(VaultRatioState::Unevaluated), 0, 0, 0});
+}
+
+void CVaultView::ForEachVaultByState(std::function<bool(const CVaultId&, const CVaultRatio&)> callback, VaultRatioState state, const CVaultId& start)
+{
+    ForEach<VaultStateKey, std::pair<uint8_t, CVaultId>, char>([&](const std::pair<uint8_t, CVaultId>& key, const char) {
+        if (key.first != uint8_t(state)) {
+            return false;
+        }
+        auto ratio = GetVaultRatio(key.second);
+        if (!ratio || ratio->state != key.first) {
+            return true;
+        }
+        return callback(key.second, *ratio);
+    }, std::make_pair(uint8_t(state), start));
+}
+
+void CVaultView::InitVaultIndexes()
+{
+    if (Exists(VaultIndexReady::prefix())) {
+        return;
+    }
+    std::vector<std::pair<CVaultId, CVaultData>> vaults;
+    ForEachVault([&](const CVaultId& vaultId, const CVaultData& vault) {
+        vaults.emplace_back(vaultId, vault);
+        return true;
+    });
+    for (const auto& vault : vaults) {
+        WriteBy<SchemeVaultKey>(std::make_pair(vault.second.schemeId, vault.first), '\0');
+        auto state = vault.second.isUnderLiquidation ? VaultRatioState::InLiquidation : VaultRatioState::Unevaluated;
+        SetVaultRatio(vault.first, CVaultRatio{uint8_t(state), 0, 0, 0});
+    }
+    Write(VaultIndexReady::prefix(), true);
+}
+
 Res CVaultView::AddVaultCollateral(const CVaultId& vaultId, CTokenAmount amount)
 {
     CBalances amounts;
@@ -77,6 +166,7 @@ Res CVaultView::AddVaultCollateral(const CVaultId& vaultId, CTokenAmount amount)
     if (!amounts.balances.empty()) {
         WriteBy<CollateralKey>(vaultId, amounts);
     }
+    MarkVaultChanged(vaultId);
     return Res::Ok();
 }
 
@@ -91,6 +181,7 @@ Res CVaultView::SubVaultCollateral(const CVaultId& vaultId, CTokenAmount amount)
     } else {
         WriteBy<CollateralKey>(vaultId, *amounts);
     }
+    MarkVaultChanged(vaultId);
     return Res::Ok();
 }
 
@@ -39,6 +39,33 @@ struct CVaultData : public CVaultMessage {
     }
 };
 
+// State of a vault as of its last collateralization ratio calculation
+enum class VaultRatioState : uint8_t {
+    Unevaluated   = 0, // changed since, holds no loans or could not be valued
+    Active        = 1,
+    MayLiquidate  = 2,
+    Frozen        = 3,
+    InLiquidation = 4,
+};
+
+struct CVaultRatio {
+    uint8_t state;
+    uint32_t height;
+    uint64_t totalCollaterals;
+    uint64_t totalLoans;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(state);
+        READWRITE(height);
+        READWRITE(totalCollaterals);
+        READWRITE(totalLoans);
+    }
+};
+
 struct CCloseVaultMessage {
     CVaultId vaultId;
     CScript to;
@@ -158,6 +185,15 @@ public:
     boost::optional<CVaultData> GetVault(const CVaultId&) const;
     Res UpdateVault(const CVaultId& vaultId, const CVaultMessage& newVault);
     void ForEachVault(std::function<bool(const CVaultId&, const CVaultData&)> callback, const CVaultId& start = {}, const CScript& ownerAddress = {});
+    void ForEachVaultByScheme(std::function<bool(const CVaultId&, const CVaultData&)> callback, const std::string& schemeId, const CVaultId& start = {});
+
+    // Ratios are recorded at collateralization ratio calculation blocks, any change to
+    // a vault drops it back to unevaluated until the next calculation
+    boost::optional<CVaultRatio> GetVaultRatio(const CVaultId& vaultId) const;
+    void SetVaultRatio(const CVaultId& vaultId, const CVaultRatio& ratio);
+    void MarkVaultChanged(const CVaultId& vaultId);
+    void ForEachVaultByState(std::function<bool(const CVaultId&, const CVaultRatio&)> callback, VaultRatioState state, const CVaultId& start = {});
+    void InitVaultIndexes();
 
     Res AddVaultCollateral(const CVaultId& vaultId, CTokenAmount amount);
     Res SubVaultCollateral(const CVaultId& vaultId, CTokenAmount amount);
@@ -183,6 +219,10 @@ public:
     struct AuctionBatchKey  { static constexpr uint8_t prefix() { return 0x23; } };
     struct AuctionHeightKey { static constexpr uint8_t prefix() { return 0x24; } };
     struct AuctionBidKey    { static constexpr uint8_t prefix() { return 0x25; } };
+    struct SchemeVaultKey   { static constexpr uint8_t prefix() { return 0x26; } };
+    struct VaultStateKey    { static constexpr uint8_t prefix() { return 0x27; } };
+    struct VaultRatioKey    { static constexpr uint8_t prefix() { return 0x28; } };
+    struct VaultIndexReady  { static constexpr uint8_t prefix() { return 0x29; } };
 };
 
 #endif // DEFI_MASTERNODES_VAULT_H
@@ -774,6 +774,9 @@ namespace pos {
             lastBlockSeen = tip->GetBlockHash();
         }
 
+        pos::CKernelSearch kernelSearch(stakeModifier, nBits, creationHeight, blockHeight, masternodeID, chainparams.GetConsensus(),
+                                        subNodesBlockTime, timelock);
+
         withSearchInterval([&](const int64_t currentTime, const int64_t lastSearchTime, const int64_t futureTime) {
             // update last block creation attempt ts for the master node here
             {
@@ -788,8 +791,7 @@ namespace pos {
 
                     blockTime = ((uint32_t)currentTime - t);
 
-                    if (pos::CheckKernelHash(stakeModifier, nBits, creationHeight, blockTime, blockHeight, masternodeID, chainparams.GetConsensus(),
-                                             subNodesBlockTime, timelock, ctxState))
+                    if (kernelSearch.Check(blockTime, ctxState))
                     {
                         if (shouldIgnoreMint(ctxState.subNode, blockHeight, creationHeight, subNodesBlockTime, chainparams)) 
                             break;
@@ -813,8 +815,7 @@ namespace pos {
 
                     blockTime = ((uint32_t)searchTime + t);
 
-                    if (pos::CheckKernelHash(stakeModifier, nBits, creationHeight, blockTime, blockHeight, masternodeID, chainparams.GetConsensus(),
-                                             subNodesBlockTime, timelock, ctxState))
+                    if (kernelSearch.Check(blockTime, ctxState))
                     {
                         if (shouldIgnoreMint(ctxState.subNode, blockHeight, creationHeight, subNodesBlockTime, chainparams)) 
                             break;
@@ -829,6 +830,8 @@ namespace pos {
             }
         }, blockHeight);
 
+        kernelHashes = kernelSearch.HashCount();
+
         if (!found) {
             return Status::stakeWaiting;
         }
@@ -948,7 +951,13 @@ void ThreadStaker::operator()(std::vector<ThreadStaker::Args> args, CChainParams
             try {
                 auto status = staker.init(chainparams);
                 if (status == Staker::Status::stakeReady) {
+                    const auto searchStart = GetTimeMicros();
                     status = staker.stake(chainparams, arg);
+                    if (staker.kernelHashes) {
+                        const auto elapsed = std::max<int64_t>(GetTimeMicros() - searchStart, 1);
+                        LogPrint(BCLog::STAKING, "ThreadStaker: (%s) %u kernel hashes in %.2fms (%.0f/s)\n", operatorName,
+                                 staker.kernelHashes, elapsed * 0.001, staker.kernelHashes * 1000000.0 / elapsed);
+                    }
                 }
                 if (status == Staker::Status::error) {
                     LogPrintf("ThreadStaker: (%s) terminated due to a staking error!\n", operatorName);
@@ -252,6 +252,9 @@ namespace pos {
         Staker::Status init(const CChainParams& chainparams);
         Staker::Status stake(const CChainParams& chainparams, const ThreadStaker::Args& args);
 
+        // kernel hashes computed by the last stake() call
+        uint64_t kernelHashes{0};
+
         // declaration static variables
         // Map to store [master node id : last block creation attempt timestamp] for local master nodes
         static std::map<uint256, int64_t> mapMNLastBlockCreationAttemptTs;
@@ -1,6 +1,8 @@
 #include <pos_kernel.h>
 #include <amount.h>
 #include <arith_uint256.h>
+#include <crypto/common.h>
+#include <hash.h>
 #include <key.h>
 #include <validation.h>
 
@@ -37,23 +39,50 @@ namespace pos {
         return (arith_uint256(nTimeTx) + period) / period;
     }
 
-    bool CheckKernelHash(const uint256& stakeModifier, uint32_t nBits, int64_t creationHeight, int64_t coinstakeTime, uint64_t blockHeight,
-                    const uint256& masternodeID, const Consensus::Params& params, const std::vector<int64_t> subNodesBlockTime, const uint16_t timelock, CheckContextState& ctxState) {
+    CKernelSearch::CKernelSearch(const uint256& stakeModifier, uint32_t nBits, int64_t creationHeight, uint64_t blockHeight,
+                                 const uint256& masternodeID, const Consensus::Params& params, std::vector<int64_t> subNodesBlockTime, uint16_t timelock)
+        : params(params), blockHeight(blockHeight), subNodesBlockTime(std::move(subNodesBlockTime))
+    {
         // Base target
-        arith_uint256 targetProofOfStake;
         targetProofOfStake.SetCompact(nBits);
+        collateral = static_cast<uint64_t>(GetMnCollateralAmount(static_cast<int>(creationHeight)));
+        loops = timelock == CMasternode::TENYEAR ? 4 : timelock == CMasternode::FIVEYEAR ? 3 : 2;
+
+        // same layout CalcKernelHash serializes, coinstake time and subnode are filled per hash
+        memcpy(kernel, stakeModifier.begin(), 32);
+        WriteLE64(kernel + 32, 0);
+        WriteLE64(kernel + 40, collateral);
+        memcpy(kernel + 48, masternodeID.begin(), 32);
+        kernel[80] = 0;
+    }
 
-        if (blockHeight >= static_cast<uint64_t>(params.EunosPayaHeight)) {
-            const uint8_t loops = timelock == CMasternode::TENYEAR ? 4 : timelock == CMasternode::FIVEYEAR ? 3 : 2;
+    uint256 CKernelSearch::Hash(int64_t coinstakeTime) {
+        uint256 hash;
+        WriteLE64(kernel + 32, static_cast<uint64_t>(coinstakeTime));
+        CHash256().Write(kernel, 80).Finalize(hash.begin());
+        ++hashCount;
+        return hash;
+    }
 
+    uint256 CKernelSearch::Hash(int64_t coinstakeTime, uint8_t subNode) {
+        uint256 hash;
+        WriteLE64(kernel + 32, static_cast<uint64_t>(coinstakeTime));
+        kernel[80] = subNode;
+        CHash256().Write(kernel, 81).Finalize(hash.begin());
+        ++hashCount;
+        return hash;
+    }
+
+    bool CKernelSearch::Check(int64_t coinstakeTime, CheckContextState& ctxState) {
+        if (blockHeight >= static_cast<uint64_t>(params.EunosPayaHeight)) {
             // Check whether we meet hash for each subnode in turn
             for (uint8_t i{0}; i < loops; ++i) {
-                const auto hashProofOfStake = UintToArith256(CalcKernelHashMulti(stakeModifier, creationHeight, coinstakeTime, masternodeID, i));
+                const auto hashProofOfStake = UintToArith256(Hash(coinstakeTime, i));
 
                 auto coinDayWeight = CalcCoinDayWeight(params, coinstakeTime, subNodesBlockTime[i]);
 
                 // Increase target by coinDayWeight.
-                if ((hashProofOfStake / static_cast<uint64_t>(GetMnCollateralAmount(static_cast<int>(creationHeight)))) <= targetProofOfStake * coinDayWeight) {
+                if ((hashProofOfStake / collateral) <= targetProofOfStake * coinDayWeight) {
                     ctxState.subNode = i;
                     return true;
                 }
@@ -62,7 +91,7 @@ namespace pos {
             return false;
         }
 
-        const auto hashProofOfStake = UintToArith256(CalcKernelHash(stakeModifier, creationHeight, coinstakeTime, masternodeID));
+        const auto hashProofOfStake = UintToArith256(Hash(coinstakeTime));
 
         // New difficulty calculation to make staking easier the longer it has
         // been since a masternode staked a block.
@@ -71,11 +100,16 @@ namespace pos {
             auto coinDayWeight = CalcCoinDayWeight(params, coinstakeTime, subNodesBlockTime[0]);
 
             // Increase target by coinDayWeight.
-            return (hashProofOfStake / static_cast<uint64_t>( GetMnCollateralAmount( static_cast<int>(creationHeight) ) ) ) <= targetProofOfStake * coinDayWeight;
+            return (hashProofOfStake / collateral) <= targetProofOfStake * coinDayWeight;
         }
 
         // Now check if proof-of-stake hash meets target protocol
-        return (hashProofOfStake / static_cast<uint64_t>( GetMnCollateralAmount( static_cast<int>(creationHeight) ) ) ) <= targetProofOfStake;
+        return (hashProofOfStake / collateral) <= targetProofOfStake;
+    }
+
+    bool CheckKernelHash(const uint256& stakeModifier, uint32_t nBits, int64_t creationHeight, int64_t coinstakeTime, uint64_t blockHeight,
+                    const uint256& masternodeID, const Consensus::Params& params, const std::vector<int64_t> subNodesBlockTime, const uint16_t timelock, CheckContextState& ctxState) {
+        return CKernelSearch(stakeModifier, nBits, creationHeight, blockHeight, masternodeID, params, subNodesBlockTime, timelock).Check(coinstakeTime, ctxState);
     }
 
     uint256 ComputeStakeModifier(const uint256& prevStakeModifier, const CKeyID& key) {
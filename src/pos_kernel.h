@@ -26,6 +26,34 @@ namespace pos {
     // Calculate target multiplier
     arith_uint256 CalcCoinDayWeight(const Consensus::Params& params, const int64_t coinstakeTime, const int64_t stakersBlockTime);
 
+/// Kernel check of one masternode with everything but the coinstake time prepared once
+    class CKernelSearch {
+    public:
+        CKernelSearch(const uint256& stakeModifier, uint32_t nBits, int64_t creationHeight, uint64_t blockHeight,
+                      const uint256& masternodeID, const Consensus::Params& params, std::vector<int64_t> subNodesBlockTime, uint16_t timelock);
+
+        /// Same result as CheckKernelHash at the given coinstake time
+        bool Check(int64_t coinstakeTime, CheckContextState& ctxState);
+
+        /// Same as CalcKernelHash and CalcKernelHashMulti
+        uint256 Hash(int64_t coinstakeTime);
+        uint256 Hash(int64_t coinstakeTime, uint8_t subNode);
+
+        /// Number of kernel hashes computed so far
+        uint64_t HashCount() const { return hashCount; }
+
+    private:
+        const Consensus::Params& params;
+        const uint64_t blockHeight;
+        const std::vector<int64_t> subNodesBlockTime;
+        arith_uint256 targetProofOfStake;
+        uint64_t collateral;
+        uint8_t loops;
+        // serialized stake modifier, coinstake time, collateral, masternode id and subnode
+        unsigned char kernel[81];
+        uint64_t hashCount{0};
+    };
+
 /// Check whether stake kernel meets hash target
     bool CheckKernelHash(const uint256& stakeModifier, uint32_t nBits, int64_t creationHeight, int64_t coinstakeTime, uint64_t blockHeight,
                          const uint256& masternodeID, const Consensus::Params& params, const std::vector<int64_t> subNodesBlockTime, const uint16_t timelock, CheckContextState& ctxState);
@@ -296,6 +296,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "compositeswap", 1, "inputs" },
     { "testpoolswap", 0, "metadata"},
     { "testpoolswap", 2, "verbose"},
+    { "testpoolswaps", 0, "swaps"},
     { "listpoolshares", 0, "pagination" },
     { "listpoolshares", 1, "verbose" },
     { "listpoolshares", 2, "is_mine_only" },
@@ -305,6 +306,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getaccounthistory", 2, "txn" },
     { "listburnhistory", 0, "options" },
     { "accounthistorycount", 1, "options" },
+    { "getburninfo", 0, "height" },
 
     { "setgov", 0, "variables" },
     { "setgov", 1, "inputs" },
@@ -6,6 +6,7 @@
 #include <chainparams.h>
 #include <crypto/ripemd160.h>
 #include <httpserver.h>
+#include <masternodes/masternodes.h>
 #include <outputtype.h>
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
@@ -448,6 +449,11 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"customview\": {           (json object) Information about the decoded object cache of the DeFi state\n"
+            "    \"hits\": xxxxx,          (numeric) Number of reads served from the cache\n"
+            "    \"misses\": xxxxx,        (numeric) Number of reads decoded from storage\n"
+            "    \"entries\": xxxxx,       (numeric) Number of cached objects\n"
             "  }\n"
             "}\n"
                     },
@@ -465,6 +471,17 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        LOCK(cs_main);
+        if (pcustomcsview) {
+            if (auto cache = pcustomcsview->GetStorage().GetDecodedCache()) {
+                auto stats = cache->GetStats();
+                UniValue cacheObj(UniValue::VOBJ);
+                cacheObj.pushKV("hits", stats.hits);
+                cacheObj.pushKV("misses", stats.misses);
+                cacheObj.pushKV("entries", stats.entries);
+                obj.pushKV("customview", cacheObj);
+            }
+        }
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
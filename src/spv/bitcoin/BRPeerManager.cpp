@@ -206,6 +206,7 @@ struct BRPeerManagerStruct {
     void (*savePeers)(void *info, int replace, const BRPeer peers[], size_t peersCount);
     int (*networkIsReachable)(void *info);
     void (*threadCleanup)(void *info);
+    BRMerkleBlock *(*loadBlock)(void *info, const UInt256& blockHash);
     boost::mutex lock;
 };
 
@@ -1638,6 +1639,15 @@ BRPeerManager *BRPeerManagerNew(const BRChainParams *params, BRWallet *wallet, u
     return manager;
 }
 
+// not thread-safe, set once before calling BRPeerManagerConnect(), info is the pointer passed to BRPeerManagerSetCallbacks()
+// BRMerkleBlock *loadBlock(void *, const UInt256&) - called to page a block that was pruned from memory back in from
+// the persistent store, must return a newly allocated block with its height set, or NULL if it isn't stored
+void BRPeerManagerSetBlockLoader(BRPeerManager *manager, BRMerkleBlock *(*loadBlock)(void *info, const UInt256& blockHash))
+{
+    assert(manager != NULL);
+    manager->loadBlock = loadBlock;
+}
+
 // not thread-safe, set callbacks once before calling BRPeerManagerConnect()
 // info is a void pointer that will be passed along with each callback call
 // void syncStarted(void *) - called when blockchain syncing starts
@@ -1910,14 +1920,31 @@ void BRPeerManagerRescanFromLastHardcodedCheckpoint(BRPeerManager *manager)
 
 static BRMerkleBlock *_BRPeerManagerLookupBlockFromBlockNumber(BRPeerManager *manager, uint32_t blockNumber)
 {
-    BRMerkleBlock *block = manager->lastBlock;
+    BRMerkleBlock *block = manager->lastBlock, *found = NULL, *prev;
+    uint32_t transition = blockNumber - (blockNumber % BLOCK_DIFFICULTY_INTERVAL);
 
-    // walk the chain, looking for blockNumber
+    // walk the chain, looking for blockNumber, and keep going back to the difficulty transition at or below it so
+    // that the rescanned chain can still be verified
     while (block) {
-        if (block->height == blockNumber) return block;
-        block = (BRMerkleBlock *)BRSetGet (manager->blocks, &block->prevBlock);
+        if (block->height == blockNumber) found = block;
+        if (block->height <= transition) break;
+        prev = (BRMerkleBlock *)BRSetGet (manager->blocks, &block->prevBlock);
+
+        if (! prev && manager->loadBlock) { // pruned from memory - page it back in from the persistent store
+            prev = manager->loadBlock(manager->info, block->prevBlock);
+
+            if (prev && prev->height + 1 != block->height) {
+                BRMerkleBlockFree(prev);
+                prev = NULL;
+            }
+            else if (prev) BRSetAdd(manager->blocks, prev);
+        }
+
+        block = prev;
     }
 
+    if (found) return found;
+
     // blockNumber not in the (abbreviated) chain - look through checkpoints
     for (uint32_t i = 0; i < manager->params->checkpointsCount; i++)
         if (manager->params->checkpoints[i].height == blockNumber) {
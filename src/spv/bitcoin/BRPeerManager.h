@@ -63,6 +63,10 @@ void BRPeerManagerSetCallbacks(BRPeerManager *manager, void *info,
                                int (*networkIsReachable)(void *info),
                                void (*threadCleanup)(void *info));
 
+// not thread-safe, set once before calling BRPeerManagerConnect()
+// BRMerkleBlock *loadBlock(void *, const UInt256&) - called to page a pruned block back in from the persistent store
+void BRPeerManagerSetBlockLoader(BRPeerManager *manager, BRMerkleBlock *(*loadBlock)(void *info, const UInt256& blockHash));
+
 // specifies a single fixed peer to use when connecting to the bitcoin network
 // set address to UINT128_ZERO to revert to default behavior
 void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t port);
@@ -60,6 +60,7 @@ std::unique_ptr<CSpvWrapper> pspv;
 static const char DB_SPVBLOCKS = 'B';     // spv "blocks" table
 static const char DB_SPVTXS    = 'T';     // spv "tx2msg" table
 static const char DB_VERSION   = 'V';
+static const char DB_SPVTIP    = 'L';     // hash of the last saved block
 
 uint64_t const DEFAULT_BTC_FEERATE = TX_FEE_PER_KB;
 uint64_t const DEFAULT_BTC_FEE_PER_KB = DEFAULT_FEE_PER_KB;
@@ -122,6 +123,12 @@ void saveBlocks(void *info, int replace, BRMerkleBlock *blocks[], size_t blocksC
     static_cast<CSpvWrapper *>(info)->OnSaveBlocks(replace, blocks, blocksCount);
 }
 
+BRMerkleBlock *loadBlock(void *info, const UInt256& blockHash)
+{
+    /// @attention called under spv manager lock!!!
+    return static_cast<CSpvWrapper *>(info)->ReadBlock(to_uint256(blockHash));
+}
+
 void blockNotify(void *info, const UInt256& blockHash)
 {
     static_cast<CSpvWrapper *>(info)->OnBlockNotify(blockHash);
@@ -279,15 +286,29 @@ void CSpvWrapper::Load()
     LogPrint(BCLog::SPV, "wallet created with first receive address: %s\n", BRWalletLegacyAddress(wallet).s);
 
     std::vector<BRMerkleBlock *> blocks;
-    // load blocks
+    // load blocks: the peer manager only keeps the chain back to its last difficulty transition in memory,
+    // older blocks stay on disk and are paged in on demand by rescans
     {
-        std::function<void (uint256 const &, db_block_rec &)> onLoadBlock = [&blocks] (uint256 const & hash, db_block_rec & rec) {
-            BRMerkleBlock *block = BRMerkleBlockParse (rec.first.data(), rec.first.size());
-            block->height = rec.second;
+        uint256 tip;
+        if (!db->Read(DB_SPVTIP, tip)) {
+            // tip wasn't recorded yet, find it once by height
+            uint32_t tipHeight{0};
+            std::function<void (uint256 const &, db_block_rec &)> onLoadBlock = [&tip, &tipHeight] (uint256 const & hash, db_block_rec & rec) {
+                if (tip.IsNull() || rec.second > tipHeight) {
+                    tip = hash;
+                    tipHeight = rec.second;
+                }
+            };
+            // can't deduce lambda here:
+            IterateTable(DB_SPVBLOCKS, onLoadBlock);
+        }
+        for (BRMerkleBlock *block = ReadBlock(tip); block; block = ReadBlock(to_uint256(block->prevBlock))) {
             blocks.push_back(block);
-        };
-        // can't deduce lambda here:
-        IterateTable(DB_SPVBLOCKS, onLoadBlock);
+            if (block->height % BLOCK_DIFFICULTY_INTERVAL == 0) {
+                break;
+            }
+        }
+        LogPrint(BCLog::SPV, "loaded %d blocks from tip %s\n", blocks.size(), tip.ToString());
     }
 
     // no need to load|keep peers!!!
@@ -296,7 +317,7 @@ void CSpvWrapper::Load()
     // can't wrap member function as static "C" function here:
     BRPeerManagerSetCallbacks(manager, this, syncStarted, syncStopped, txStatusUpdate,
                               saveBlocks, blockNotify, savePeers, nullptr /*networkIsReachable*/, threadCleanup);
-
+    BRPeerManagerSetBlockLoader(manager, loadBlock);
 }
 
 CSpvWrapper::~CSpvWrapper()
@@ -496,15 +517,18 @@ void CSpvWrapper::OnTxStatusUpdate()
 void CSpvWrapper::OnSaveBlocks(int replace, BRMerkleBlock * blocks[], size_t blocksCount)
 {
     /// @attention called under spv manager lock!!!
-    if (replace)
-    {
-        LogPrint(BCLog::SPV, "BLOCK: 'replace' requested, deleting...\n");
-        DeleteTable<uint256>(DB_SPVBLOCKS);
-    }
+    // blocks are keyed by hash and never change, so 'replace' only writes the missing ones and moves the tip.
+    // stale blocks are left in place, Load() only follows the chain back from the tip.
     for (size_t i = 0; i < blocksCount; ++i) {
+        if (replace && db->Exists(std::make_pair(DB_SPVBLOCKS, to_uint256(blocks[i]->blockHash)))) {
+            continue;
+        }
         WriteBlock(blocks[i]);
         LogPrint(BCLog::SPV, "BLOCK: %u, %s saved\n", blocks[i]->height, to_uint256(blocks[i]->blockHash).ToString());
     }
+    if (blocksCount > 0) {
+        BatchWrite(DB_SPVTIP, to_uint256(blocks[0]->blockHash));
+    }
     CommitBatch();
 
     /// @attention don't call ANYTHING that could call back to spv here! cause OnSaveBlocks works under spv lock!!!
@@ -611,6 +635,19 @@ void CSpvWrapper::EraseTx(uint256 const & hash)
     db->Erase(std::make_pair(DB_SPVTXS, hash));
 }
 
+BRMerkleBlock * CSpvWrapper::ReadBlock(uint256 const & hash)
+{
+    db_block_rec rec;
+    if (!db->Read(std::make_pair(DB_SPVBLOCKS, hash), rec)) {
+        return nullptr;
+    }
+    BRMerkleBlock *block = BRMerkleBlockParse(rec.first.data(), rec.first.size());
+    if (block) {
+        block->height = rec.second;
+    }
+    return block;
+}
+
 void CSpvWrapper::WriteBlock(const BRMerkleBlock * block)
 {
     static TBytes buf;
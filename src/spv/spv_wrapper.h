@@ -133,6 +133,7 @@ public:
     void OnSaveBlocks(int replace, BRMerkleBlock *blocks[], size_t blocksCount);
     void OnSavePeers(int replace, const BRPeer peers[], size_t peersCount);
     void OnThreadCleanup();
+    BRMerkleBlock * ReadBlock(uint256 const & hash);
 
     /// Wallet notifications
     void OnBlockNotify(const UInt256& blockHash);
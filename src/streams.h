@@ -8,6 +8,7 @@
 
 #include <support/allocators/zeroafterfree.h>
 #include <serialize.h>
+#include <span.h>
 
 #include <algorithm>
 #include <assert.h>
@@ -134,7 +135,7 @@ class VectorReader
 private:
     const int m_type;
     const int m_version;
-    const std::vector<unsigned char>& m_data;
+    const Span<const unsigned char> m_data;
     size_t m_pos = 0;
 
 public:
@@ -146,9 +147,18 @@ public:
      * @param[in]  pos Starting position. Vector index where reads should start.
      */
     VectorReader(int type, int version, const std::vector<unsigned char>& data, size_t pos)
+        : VectorReader(type, version, Span<const unsigned char>(data.data(), data.size()), pos)
+    {
+    }
+
+    /**
+     * (other params same as above)
+     * @param[in]  data Referenced bytes, they must outlive the reader
+     */
+    VectorReader(int type, int version, Span<const unsigned char> data, size_t pos)
         : m_type(type), m_version(version), m_data(data), m_pos(pos)
     {
-        if (m_pos > m_data.size()) {
+        if (m_pos > size_t(m_data.size())) {
             throw std::ios_base::failure("VectorReader(...): end of data (m_pos > m_data.size())");
         }
     }
@@ -177,7 +187,7 @@ public:
     int GetType() const { return m_type; }
 
     size_t size() const { return m_data.size() - m_pos; }
-    bool empty() const { return m_data.size() == m_pos; }
+    bool empty() const { return size_t(m_data.size()) == m_pos; }
 
     void read(char* dst, size_t n)
     {
@@ -187,7 +197,7 @@ public:
 
         // Read from the beginning of the buffer
         size_t pos_next = m_pos + n;
-        if (pos_next > m_data.size()) {
+        if (pos_next > size_t(m_data.size())) {
             throw std::ios_base::failure("VectorReader::read(): end of data");
         }
         memcpy(dst, m_data.data() + m_pos, n);
@@ -0,0 +1,155 @@
+// Copyright (c) DeFi Blockchain Developers
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DEFI_SUPPORT_ALLOCATORS_NODE_ARENA_H
+#define DEFI_SUPPORT_ALLOCATORS_NODE_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+/**
+ * Chunked arena for fixed size nodes of node based containers (std::map, std::set).
+ * Nodes are carved out of geometrically growing chunks and recycled through
+ * an intrusive free list; all chunks are released at once when the arena dies.
+ * The arena serves a single node size, the first one requested; any other
+ * allocation falls through to the global heap.
+ */
+class CNodeArena {
+public:
+    CNodeArena() = default;
+    CNodeArena(const CNodeArena&) = delete;
+    CNodeArena& operator=(const CNodeArena&) = delete;
+
+    void* Allocate(std::size_t size) {
+        if (nodeSize == 0) {
+            nodeSize = std::max(Align(size), sizeof(FreeNode));
+        }
+        if (Align(size) > nodeSize) {
+            return ::operator new(size);
+        }
+        if (freeList) {
+            auto node = freeList;
+            freeList = freeList->next;
+            return node;
+        }
+        if (chunkLeft == 0) {
+            NewChunk();
+        }
+        auto node = chunkPtr;
+        chunkPtr += nodeSize;
+        --chunkLeft;
+        return node;
+    }
+
+    void Deallocate(void* ptr, std::size_t size) {
+        if (Align(size) > nodeSize) {
+            ::operator delete(ptr);
+            return;
+        }
+        auto node = static_cast<FreeNode*>(ptr);
+        node->next = freeList;
+        freeList = node;
+    }
+
+    // Releases every chunk, only valid once all nodes have been returned
+    void Clear() {
+        chunks.clear();
+        freeList = nullptr;
+        chunkPtr = nullptr;
+        chunkLeft = 0;
+        chunkNodes = 0;
+        allocated = 0;
+    }
+
+    // Bytes reserved from the heap
+    std::size_t DynamicUsage() const {
+        return allocated;
+    }
+
+    std::size_t ChunkCount() const {
+        return chunks.size();
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    static constexpr std::size_t MIN_CHUNK_NODES = 16;
+    static constexpr std::size_t MAX_CHUNK_NODES = 4096;
+
+    static std::size_t Align(std::size_t size) {
+        constexpr auto align = alignof(std::max_align_t);
+        return (size + align - 1) & ~(align - 1);
+    }
+
+    void NewChunk() {
+        auto count = chunks.empty() ? MIN_CHUNK_NODES : std::min(chunkNodes * 2, MAX_CHUNK_NODES);
+        chunks.emplace_back(new char[count * nodeSize]);
+        chunkNodes = count;
+        chunkLeft = count;
+        chunkPtr = chunks.back().get();
+        allocated += count * nodeSize;
+    }
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    FreeNode* freeList = nullptr;
+    char* chunkPtr = nullptr;
+    std::size_t chunkLeft = 0;
+    std::size_t chunkNodes = 0;
+    std::size_t nodeSize = 0;
+    std::size_t allocated = 0;
+};
+
+/**
+ * Stateful allocator handing out single nodes from a CNodeArena.
+ * A default constructed allocator has no arena and uses the global heap,
+ * so containers declared without one keep working as before.
+ * The arena must outlive every container bound to it.
+ */
+template <typename T>
+class node_arena_allocator {
+public:
+    using value_type = T;
+
+    node_arena_allocator() noexcept = default;
+    explicit node_arena_allocator(CNodeArena* arena) noexcept : arena(arena) {}
+    template <typename U>
+    node_arena_allocator(const node_arena_allocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(std::size_t n) {
+        if (arena && n == 1) {
+            return static_cast<T*>(arena->Allocate(sizeof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        if (arena && n == 1) {
+            arena->Deallocate(p, sizeof(T));
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const node_arena_allocator<U>& other) const noexcept {
+        return arena == other.arena;
+    }
+    template <typename U>
+    bool operator!=(const node_arena_allocator<U>& other) const noexcept {
+        return arena != other.arena;
+    }
+
+private:
+    template <typename U>
+    friend class node_arena_allocator;
+
+    CNodeArena* arena = nullptr;
+};
+
+#endif // DEFI_SUPPORT_ALLOCATORS_NODE_ARENA_H
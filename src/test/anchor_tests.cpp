@@ -34,6 +34,38 @@ void createTeams(std::vector<CKey>& signers, CAnchorData::CTeam& team) {
 
 BOOST_FIXTURE_TEST_SUITE(anchor_tests, SpvTestingSetup)
 
+BOOST_AUTO_TEST_CASE(next_team_selection)
+{
+    CCustomCSView mnview(*pcustomcsview);
+    for (int i{0}; i < 30; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        CMasternode node;
+        node.operatorType = node.ownerType = 1;
+        node.operatorAuthAddress = node.ownerAuthAddress = key.GetPubKey().GetID();
+        node.creationHeight = 0;
+        BOOST_REQUIRE(mnview.CreateMasternode(uint256S(strprintf("%x", i + 1)), node, 0));
+    }
+
+    const auto stakeModifier = uint256S("0x4c4");
+    std::map<arith_uint256, CKeyID> priorityMN;
+    mnview.ForEachMasternode([&](uint256 const & id, CMasternode node) {
+        if (node.IsActive(1)) {
+            CDataStream ss{SER_GETHASH, PROTOCOL_VERSION};
+            ss << id << stakeModifier;
+            priorityMN.emplace(UintToArith256(Hash(ss.begin(), ss.end())), node.operatorAuthAddress);
+        }
+        return true;
+    });
+    CAnchorData::CTeam expected;
+    for (auto it = priorityMN.begin(); it != priorityMN.end() && expected.size() < static_cast<size_t>(Params().GetConsensus().mn.anchoringTeamSize); ++it) {
+        expected.insert(it->second);
+    }
+
+    BOOST_CHECK_EQUAL(expected.size(), Params().GetConsensus().mn.anchoringTeamSize);
+    BOOST_CHECK(mnview.CalcNextTeam(1, stakeModifier) == expected);
+}
+
 BOOST_AUTO_TEST_CASE(anchor_order_logic)
 {
     CAnchorIndex::AnchorRec anchorOne;
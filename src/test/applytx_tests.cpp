@@ -9,6 +9,7 @@
 #include <validation.h>
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 
 BOOST_FIXTURE_TEST_SUITE(applytx_tests, TestingSetup)
@@ -176,5 +177,77 @@ BOOST_AUTO_TEST_CASE(apply_a2a_neg)
     }
 }
 
+BOOST_AUTO_TEST_CASE(apply_block_speculative)
+{
+    Consensus::Params amkCheated = Params().GetConsensus();
+    amkCheated.AMKHeight = 0;
+
+    CCustomCSView mnview(*pcustomcsview);
+    CCoinsViewCache coinview(&::ChainstateActive().CoinsTip());
+    DCT_ID DFI{0};
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(CMutableTransaction{}));
+    for (int i = 0; i < 20; ++i) {
+        CScript owner = CScript(1000 + i);
+        auto auth_out = COutPoint(uint256S(strprintf("0x%x", 0xafaf00 + i)), 1);
+        coinview.AddCoin(auth_out, Coin(CTxOut(1, owner, DFI), 1, false), false);
+        BOOST_REQUIRE(mnview.AddBalance(owner, CTokenAmount{DFI, 100}));
+
+        // the first half pays the next owner more than it held before the block, so it only succeeds in order
+        CAccountToAccountMessage msg{};
+        msg.from = owner;
+        if (i < 10) {
+            msg.to = {{ CScript(1000 + i + 1), CBalances{{ {DFI, i == 0 ? 60 : 130} }} }};
+        } else {
+            msg.to = {{ CScript(2000 + i), CBalances{{ {DFI, 40} }} }};
+        }
+        CMutableTransaction rawTx;
+        rawTx.vout = { CTxOut(0, CreateMetaA2A(msg)) };
+        rawTx.vin = { CTxIn(auth_out) };
+        block.vtx.push_back(MakeTransactionRef(rawTx));
+    }
+
+    CCustomCSView serialView(mnview);
+    CCustomTxExecutor serial(serialView, coinview, block, amkCheated, 1, 0, nullptr);
+    std::vector<Res> serialResults;
+    for (uint32_t i = 1; i < block.vtx.size(); ++i) {
+        serialResults.push_back(serial.Apply(i, nullptr));
+    }
+    BOOST_CHECK_EQUAL(serial.Speculated(), 0);
+
+    CCheckQueue<CCustomTxCheck> queue(4);
+    boost::thread_group workers;
+    for (int i = 0; i < 3; ++i) {
+        workers.create_thread([&]() { queue.Thread(); });
+    }
+    CCustomCSView parallelView(mnview);
+    CCustomTxExecutor parallel(parallelView, coinview, block, amkCheated, 1, 0, &queue);
+    workers.interrupt_all();
+    workers.join_all();
+    std::vector<Res> parallelResults;
+    for (uint32_t i = 1; i < block.vtx.size(); ++i) {
+        parallelResults.push_back(parallel.Apply(i, nullptr));
+    }
+    BOOST_CHECK_EQUAL(parallel.Speculated(), 20);
+    // txs reading balances paid earlier in the block are applied again
+    BOOST_CHECK_EQUAL(parallel.Committed(), 10);
+
+    for (size_t i = 0; i < serialResults.size(); ++i) {
+        BOOST_CHECK(serialResults[i].ok);
+        BOOST_CHECK_EQUAL(serialResults[i].ok, parallelResults[i].ok);
+        BOOST_CHECK_EQUAL(serialResults[i].msg, parallelResults[i].msg);
+    }
+    // same balances and undo records
+    const auto& serialChanges = serialView.GetStorage().GetRaw();
+    const auto& parallelChanges = parallelView.GetStorage().GetRaw();
+    BOOST_REQUIRE_EQUAL(serialChanges.size(), parallelChanges.size());
+    for (auto it = serialChanges.begin(), jt = parallelChanges.begin(); it != serialChanges.end(); ++it, ++jt) {
+        BOOST_CHECK(it->first == jt->first);
+        BOOST_CHECK(it->second == jt->second);
+    }
+    BOOST_CHECK_EQUAL(parallelView.GetBalance(CScript(1010), DFI), (CTokenAmount{DFI, 190}));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
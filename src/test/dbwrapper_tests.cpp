@@ -107,6 +107,15 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
         BOOST_CHECK_EQUAL(key_res, key);
         BOOST_CHECK_EQUAL(val_res.ToString(), in.ToString());
 
+        // raw access yields the same bytes without deserialization
+        std::vector<unsigned char> buffer;
+        auto raw_key = it->GetKeyBytes();
+        auto raw_value = it->GetValueBytes(buffer);
+        BOOST_REQUIRE_EQUAL(raw_key.size(), 1);
+        BOOST_CHECK_EQUAL(raw_key[0], key);
+        BOOST_CHECK(std::equal(raw_value.begin(), raw_value.end(), in.begin(), in.end()));
+        BOOST_CHECK_EQUAL(buffer.empty(), !obfuscate);
+
         it->Next();
 
         BOOST_REQUIRE(it->GetKey(key_res));
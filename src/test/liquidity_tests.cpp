@@ -1,5 +1,7 @@
 #include <chainparams.h>
+#include <masternodes/accountshistory.h>
 #include <masternodes/masternodes.h>
+#include <masternodes/mn_checks.h>
 #include <masternodes/poolpairs.h>
 #include <validation.h>
 
@@ -507,4 +509,240 @@ BOOST_AUTO_TEST_CASE(owner_rewards)
     });
 }
 
+
+BOOST_AUTO_TEST_CASE(owner_reward_ranges)
+{
+    CCustomCSView mnview(*pcustomcsview);
+
+    constexpr const int PoolCount = 3;
+    constexpr const uint32_t Height = 3000;
+    const CScript owner = CScript(42);
+    DCT_ID lastPool;
+
+    const_cast<int&>(Params().GetConsensus().BayfrontGardensHeight) = 700;
+
+    for (int i = 0; i < PoolCount; ++i) {
+        DCT_ID idA, idB, idPool;
+        std::tie(idA, idB, idPool) = CreatePoolNTokens(mnview, "A"+std::to_string(i), "B"+std::to_string(i));
+        BOOST_REQUIRE(AddPoolLiquidity(mnview, idPool, (i + 1) * COIN, (i + 2) * COIN, CScript(i)).ok);
+        BOOST_REQUIRE(AddPoolLiquidity(mnview, idPool, COIN / (i + 3), COIN, owner).ok);
+        mnview.SetRewardPct(idPool, 1, COIN / (i + 2));
+        mnview.SetRewardLoanPct(idPool, 1, COIN / (i + 4));
+        lastPool = idPool;
+    }
+    mnview.SetDailyReward(1, 1000 * COIN);
+
+    // replay a random pool history
+    for (uint32_t height = 2; height < Height; ++height) {
+        if (InsecureRandRange(200) == 0) {
+            mnview.SetDailyReward(height, InsecureRandRange(10000) * COIN);
+        }
+        if (InsecureRandRange(300) == 0) {
+            mnview.SetLoanDailyReward(height, InsecureRandRange(10000) * COIN);
+        }
+        mnview.ForEachPoolPair([&] (DCT_ID const & idPool, CPoolPair pool) {
+            if (InsecureRandRange(3) == 0) {
+                pool.swapEvent = true;
+                pool.blockCommissionA = InsecureRandRange(COIN);
+                pool.blockCommissionB = InsecureRandRange(COIN);
+            }
+            if (InsecureRandRange(50) == 0) {
+                pool.totalLiquidity += InsecureRandRange(COIN);
+            }
+            BOOST_REQUIRE(mnview.SetPoolPair(idPool, height, pool).ok);
+            if (InsecureRandRange(250) == 0) {
+                mnview.SetRewardPct(idPool, height, InsecureRandRange(COIN));
+            }
+            if (InsecureRandRange(400) == 0) {
+                // last pool is rewarded in its own token as well
+                CBalances rewards{TAmounts{{DCT_ID{0}, InsecureRandRange(COIN)}}};
+                if (idPool == lastPool) {
+                    rewards.Add({idPool, InsecureRandRange(COIN)});
+                }
+                BOOST_REQUIRE(mnview.UpdatePoolPair(idPool, height, true, -1, {}, rewards).ok);
+            }
+            return true;
+        });
+    }
+
+    auto balances = [&](CCustomCSView& view) {
+        TAmounts result;
+        view.ForEachBalance([&](CScript const & balanceOwner, CTokenAmount const & balance) {
+            if (balanceOwner != owner) {
+                return false;
+            }
+            result[balance.nTokenId] = balance.nValue;
+            return true;
+        }, BalanceKey{owner, DCT_ID{}});
+        return result;
+    };
+
+    for (int i = 0; i < 20; ++i) {
+        uint32_t begin = InsecureRandRange(Height);
+        uint32_t end = begin + InsecureRandRange(Height - begin + 10);
+
+        // legacy per block loop
+        CCustomCSView legacy(mnview);
+        legacy.ForEachPoolId([&](DCT_ID const & idPool) {
+            auto onLiquidity = [&]() -> CAmount {
+                return legacy.GetBalance(owner, idPool).nValue;
+            };
+            legacy.CalculatePoolRewards(idPool, onLiquidity, begin, end,
+                [&](RewardType, CTokenAmount amount, uint32_t) {
+                    legacy.AddBalance(owner, amount);
+                }
+            );
+            return true;
+        });
+
+        CCustomCSView ranges(mnview);
+        ranges.ForEachPoolId([&](DCT_ID const & idPool) {
+            auto onLiquidity = [&]() -> CAmount {
+                return ranges.GetBalance(owner, idPool).nValue;
+            };
+            ranges.CalculatePoolRewardRanges(idPool, onLiquidity, begin, end,
+                [&](RewardType, CTokenAmount amount, uint32_t rangeBegin, uint32_t rangeEnd) {
+                    BOOST_REQUIRE(rangeBegin < rangeEnd);
+                    amount.nValue *= rangeEnd - rangeBegin;
+                    ranges.AddBalance(owner, amount);
+                }
+            );
+            return true;
+        });
+
+        BOOST_CHECK(balances(legacy) == balances(ranges));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(composite_swap_paths)
+{
+    CCustomCSView mnview(*pcustomcsview);
+    auto& consensus = const_cast<Consensus::Params&>(Params().GetConsensus());
+    const auto fortCanningHeight = consensus.FortCanningHeight;
+    consensus.FortCanningHeight = 7;
+
+    DCT_ID idA = CreateToken(mnview, "A");
+    DCT_ID idB = CreateToken(mnview, "B");
+    DCT_ID idC = CreateToken(mnview, "C");
+    DCT_ID idD = CreateToken(mnview, "D");
+
+    auto createPool = [&](DCT_ID tokenA, DCT_ID tokenB, CAmount reserveA, CAmount reserveB) {
+        DCT_ID idPool = CreateToken(mnview, "LP" + tokenA.ToString() + tokenB.ToString(), (uint8_t)CToken::TokenFlags::Default | (uint8_t)CToken::TokenFlags::DAT | (uint8_t)CToken::TokenFlags::LPS);
+        CPoolPair pool{};
+        pool.idTokenA = tokenA;
+        pool.idTokenB = tokenB;
+        pool.commission = 1000000; // 1%
+        pool.status = true;
+        BOOST_REQUIRE(mnview.SetPoolPair(idPool, 1, pool).ok);
+        BOOST_REQUIRE(AddPoolLiquidity(mnview, idPool, reserveA, reserveB, CScript(idPool.v)).ok);
+        return idPool;
+    };
+
+    auto poolAB = createPool(idA, idB, 1000 * COIN, 1000 * COIN);
+    auto poolBD = createPool(idB, idD, 1000 * COIN, 1000 * COIN);
+    auto poolAC = createPool(idA, idC, 1000 * COIN, 1000 * COIN);
+    auto poolCD = createPool(idC, idD, 1000 * COIN, 4000 * COIN);
+    auto poolBC = createPool(idB, idC, 1000 * COIN, 1000 * COIN);
+
+    CPoolSwapMessage msg{};
+    msg.idTokenFrom = idA;
+    msg.idTokenTo = idD;
+    msg.amountFrom = 10 * COIN;
+    msg.maxPrice = POOLPRICE_MAX;
+    CPoolSwap swap(msg, 10);
+
+    const std::vector<std::vector<DCT_ID>> expected{
+        {poolAB, poolBD},
+        {poolAB, poolBC, poolCD},
+        {poolAC, poolCD},
+        {poolAC, poolBC, poolBD},
+    };
+    BOOST_CHECK(swap.CalculatePoolPaths(mnview) == expected);
+    BOOST_CHECK(swap.CalculatePoolPaths(mnview, 2) == std::vector<std::vector<DCT_ID>>({{poolAB, poolBD}, {poolAC, poolCD}}));
+
+    // deepest pool wins and matches the amount of a test swap over it
+    auto best = swap.CalculateSwaps(mnview, true);
+    BOOST_CHECK(best == std::vector<DCT_ID>({poolAC, poolCD}));
+    BOOST_REQUIRE(swap.ExecuteSwap(mnview, best, true));
+    auto bestAmount = swap.GetResult().nValue;
+    CPoolSwapCache cache;
+    for (const auto& path : expected) {
+        BOOST_REQUIRE(swap.ExecuteSwap(mnview, path, true));
+        BOOST_CHECK(swap.GetResult().nValue <= bestAmount);
+        // shared reads give the same amount as a test swap
+        auto simulated = swap.SimulateSwap(mnview, path, cache);
+        BOOST_REQUIRE(simulated);
+        BOOST_CHECK_EQUAL(*simulated.val, swap.GetResult().nValue);
+    }
+    BOOST_CHECK_EQUAL(cache.pools.size(), 5);
+
+    // new pool drops the cached graph
+    auto graph = mnview.GetPoolGraph();
+    BOOST_CHECK_EQUAL(graph->at(idD).size(), 2);
+    auto poolAD = createPool(idA, idD, 1000 * COIN, 1000 * COIN);
+    BOOST_CHECK(mnview.GetPoolGraph() != graph);
+    BOOST_CHECK_EQUAL(mnview.GetPoolGraph()->at(idD).size(), 3);
+    BOOST_CHECK(mnview.GetPoolGraph()->at(idD).back() == std::make_pair(poolAD, idA));
+    // direct pool is never a composite path
+    BOOST_CHECK_EQUAL(swap.CalculatePoolPaths(mnview).size(), expected.size());
+
+    consensus.FortCanningHeight = fortCanningHeight;
+}
+
+BOOST_AUTO_TEST_CASE(reward_history)
+{
+    CCustomCSView mnview(*pcustomcsview);
+    const CScript owner = CScript(7);
+
+    DCT_ID idA, idB, idPool;
+    std::tie(idA, idB, idPool) = CreatePoolNTokens(mnview, "A", "B");
+    BOOST_REQUIRE(AddPoolLiquidity(mnview, idPool, COIN, COIN, CScript(1)).ok);
+    BOOST_REQUIRE(AddPoolLiquidity(mnview, idPool, COIN, 2 * COIN, owner).ok);
+    mnview.SetRewardPct(idPool, 1, COIN);
+    mnview.SetDailyReward(1, 2880 * COIN);
+    mnview.SetDailyReward(50, 5760 * COIN);
+    BOOST_REQUIRE(mnview.UpdateBalancesHeight(owner, 10).ok);
+
+    CAccountHistoryStorage historyView(GetDataDir() / "rewardhistory", 1 << 20, true, true);
+    historyView.InitRewardHistory(true);
+
+    // block 100 settles the owner rewards
+    CCustomCSView block(mnview);
+    BOOST_REQUIRE(block.CalculateOwnerRewards(owner, 100));
+    WriteBlockRewardHistory(historyView, mnview, block.GetStorage().GetRaw(), 100);
+    BOOST_REQUIRE(historyView.Flush());
+    BOOST_REQUIRE(historyView.GetRewardHistoryStart());
+    BOOST_CHECK_EQUAL(*historyView.GetRewardHistoryStart(), 100);
+
+    CAmount settled = 0;
+    uint32_t begin = 100, end = 0;
+    historyView.ForEachRewardHistory([&](RewardHistoryKey const & key, CLazySerialize<RewardHistoryValue> valueLazy) {
+        BOOST_CHECK(key.owner == owner);
+        BOOST_CHECK_EQUAL(key.blockHeight, 100);
+        BOOST_CHECK(key.poolID == idPool);
+        for (const auto& range : valueLazy.get()) {
+            settled += range.amount.nValue * (range.end - range.begin);
+            begin = std::min(begin, range.begin);
+            end = std::max(end, range.end);
+        }
+        return true;
+    });
+    BOOST_CHECK_EQUAL(begin, 10);
+    BOOST_CHECK_EQUAL(end, 100);
+    BOOST_CHECK_GT(settled, 0);
+    BOOST_CHECK_EQUAL(settled, block.GetBalance(owner, DCT_ID{0}).nValue - mnview.GetBalance(owner, DCT_ID{0}).nValue);
+
+    // disconnect restores the balances height
+    CCustomCSView disconnect(block);
+    BOOST_REQUIRE(disconnect.UpdateBalancesHeight(owner, 10).ok);
+    EraseBlockRewardHistory(historyView, disconnect.GetStorage().GetRaw(), 100);
+    BOOST_REQUIRE(historyView.Flush());
+    bool found = false;
+    historyView.ForEachRewardHistory([&](RewardHistoryKey const &, CLazySerialize<RewardHistoryValue>) {
+        found = true;
+        return false;
+    });
+    BOOST_CHECK(!found);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 
 #include <test/setup_common.h>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 #include <boost/variant.hpp>
 #include <algorithm>
 
@@ -455,4 +456,197 @@ BOOST_AUTO_TEST_CASE(auction_batch_creator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(liquidation_candidates)
+{
+    CCustomCSView mnview(*pcustomcsview);
+
+    const std::string id("sch1");
+    CreateScheme(mnview, id, 150, 1 * COIN);
+
+    auto dfi_id = DCT_ID{0};
+    auto tesla_id = CreateLoanToken(mnview, "TSLA", "TESLA", "TSLA/USD", 0);
+    CreateCollateralToken(mnview, dfi_id, "DFI/USD");
+
+    CFixedIntervalPrice fixedIntervalPrice{};
+    fixedIntervalPrice.priceFeedId = {"TSLA", "USD"};
+    fixedIntervalPrice.priceRecord[1] = 3*COIN;
+    fixedIntervalPrice.priceRecord[0] = 3*COIN;
+    BOOST_REQUIRE(mnview.SetFixedIntervalPrice(fixedIntervalPrice));
+    fixedIntervalPrice.priceFeedId = {"DFI", "USD"};
+    fixedIntervalPrice.priceRecord[1] = 5*COIN;
+    fixedIntervalPrice.priceRecord[0] = 5*COIN;
+    BOOST_REQUIRE(mnview.SetFixedIntervalPrice(fixedIntervalPrice));
+
+    auto createVault = [&](CAmount collateral, CAmount loan) {
+        auto vault_id = NextTx();
+        CVaultData msg{};
+        msg.schemeId = id;
+        BOOST_REQUIRE(mnview.StoreVault(vault_id, msg));
+        BOOST_REQUIRE(mnview.AddVaultCollateral(vault_id, {dfi_id, collateral}));
+        if (loan > 0) {
+            BOOST_REQUIRE(mnview.AddLoanToken(vault_id, {tesla_id, loan}));
+            BOOST_REQUIRE(mnview.StoreInterest(1, vault_id, id, tesla_id, loan));
+        }
+        return vault_id;
+    };
+
+    // 50 USD against 30 USD, 166%
+    auto healthy_id = createVault(10 * COIN, 10 * COIN);
+    // 25 USD against 30 USD, 83%
+    auto unhealthy_id = createVault(5 * COIN, 10 * COIN);
+    // no loans, never liquidated
+    createVault(1 * COIN, 0);
+
+    auto candidates = mnview.GetLiquidationCandidates(10, 0);
+    BOOST_REQUIRE_EQUAL(candidates.size(), 1);
+    BOOST_CHECK(candidates[0].vaultId == unhealthy_id);
+    BOOST_CHECK_EQUAL(candidates[0].collaterals.balances[dfi_id], 5 * COIN);
+    BOOST_CHECK_EQUAL(candidates[0].collateral.ratio(), 83);
+
+    auto colls = mnview.GetLoanCollaterals(healthy_id, *mnview.GetVaultCollaterals(healthy_id), 10, 0);
+    BOOST_REQUIRE(colls.ok);
+    BOOST_CHECK_EQUAL(colls.val->ratio(), 167);
+
+    // falling collateral price moves the healthy vault below its scheme ratio
+    fixedIntervalPrice.priceRecord[1] = 4*COIN;
+    fixedIntervalPrice.priceRecord[0] = 4*COIN;
+    BOOST_REQUIRE(mnview.SetFixedIntervalPrice(fixedIntervalPrice));
+
+    candidates = mnview.GetLiquidationCandidates(10, 0);
+    BOOST_REQUIRE_EQUAL(candidates.size(), 2);
+    std::set<CVaultId> ids{candidates[0].vaultId, candidates[1].vaultId};
+    BOOST_CHECK(ids.count(healthy_id));
+    BOOST_CHECK(ids.count(unhealthy_id));
+    BOOST_CHECK(candidates[0].vaultId < candidates[1].vaultId);
+
+    // parallel evaluation yields the same candidates in the same order
+    for (int i = 0; i < 50; ++i) {
+        createVault((i % 3 + 5) * COIN, 10 * COIN);
+    }
+    auto serial = mnview.GetLiquidationCandidates(10, 0);
+
+    CCheckQueue<CLiquidationCheck> queue(4);
+    boost::thread_group workers;
+    for (int i = 0; i < 3; ++i) {
+        workers.create_thread([&]() { queue.Thread(); });
+    }
+    auto parallel = mnview.GetLiquidationCandidates(10, 0, &queue);
+    workers.interrupt_all();
+    workers.join_all();
+
+    BOOST_REQUIRE_EQUAL(serial.size(), parallel.size());
+    for (size_t i = 0; i < serial.size(); ++i) {
+        BOOST_CHECK(serial[i].vaultId == parallel[i].vaultId);
+        BOOST_CHECK_EQUAL(serial[i].collateral.ratio(), parallel[i].collateral.ratio());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(vault_indexes)
+{
+    CCustomCSView mnview(*pcustomcsview);
+
+    CreateScheme(mnview, "sch1", 150, 1 * COIN);
+    CreateScheme(mnview, "sch2", 200, 1 * COIN);
+
+    auto dfi_id = DCT_ID{0};
+    auto tesla_id = CreateLoanToken(mnview, "TSLA", "TESLA", "TSLA/USD", 0);
+    CreateCollateralToken(mnview, dfi_id, "DFI/USD");
+
+    CFixedIntervalPrice fixedIntervalPrice{};
+    fixedIntervalPrice.priceFeedId = {"TSLA", "USD"};
+    fixedIntervalPrice.priceRecord[1] = 3*COIN;
+    fixedIntervalPrice.priceRecord[0] = 3*COIN;
+    BOOST_REQUIRE(mnview.SetFixedIntervalPrice(fixedIntervalPrice));
+    fixedIntervalPrice.priceFeedId = {"DFI", "USD"};
+    fixedIntervalPrice.priceRecord[1] = 4*COIN;
+    fixedIntervalPrice.priceRecord[0] = 5*COIN;
+    BOOST_REQUIRE(mnview.SetFixedIntervalPrice(fixedIntervalPrice));
+
+    auto createVault = [&](const std::string& scheme, CAmount collateral, CAmount loan) {
+        auto vault_id = NextTx();
+        CVaultData msg{};
+        msg.schemeId = scheme;
+        BOOST_REQUIRE(mnview.StoreVault(vault_id, msg));
+        BOOST_REQUIRE(mnview.AddVaultCollateral(vault_id, {dfi_id, collateral}));
+        BOOST_REQUIRE(mnview.AddLoanToken(vault_id, {tesla_id, loan}));
+        BOOST_REQUIRE(mnview.StoreInterest(1, vault_id, scheme, tesla_id, loan));
+        return vault_id;
+    };
+
+    auto byScheme = [&](const std::string& scheme) {
+        std::set<CVaultId> ids;
+        mnview.ForEachVaultByScheme([&](const CVaultId& vaultId, const CVaultData& vault) {
+            BOOST_CHECK_EQUAL(vault.schemeId, scheme);
+            ids.insert(vaultId);
+            return true;
+        }, scheme);
+        return ids;
+    };
+
+    auto byState = [&](VaultRatioState state) {
+        std::set<CVaultId> ids;
+        mnview.ForEachVaultByState([&](const CVaultId& vaultId, const CVaultRatio& ratio) {
+            BOOST_CHECK_EQUAL(ratio.state, uint8_t(state));
+            ids.insert(vaultId);
+            return true;
+        }, state);
+        return ids;
+    };
+
+    // 100 USD against 30 USD, 80 USD with next price
+    auto active_id = createVault("sch1", 20 * COIN, 10 * COIN);
+    // 50 USD against 30 USD, 40 USD with next price
+    auto next_id = createVault("sch1", 10 * COIN, 10 * COIN);
+    auto liquidate_id = createVault("sch2", 10 * COIN, 10 * COIN);
+
+    BOOST_CHECK(byScheme("sch1") == (std::set<CVaultId>{active_id, next_id}));
+    BOOST_CHECK(byScheme("sch2") == std::set<CVaultId>{liquidate_id});
+    BOOST_CHECK_EQUAL(byState(VaultRatioState::Unevaluated).size(), 3);
+
+    std::vector<std::pair<CVaultId, CVaultRatio>> ratios;
+    auto candidates = mnview.GetLiquidationCandidates(10, 0, nullptr, &ratios);
+    BOOST_REQUIRE_EQUAL(candidates.size(), 1);
+    BOOST_CHECK(candidates[0].vaultId == liquidate_id);
+    BOOST_REQUIRE_EQUAL(ratios.size(), 3);
+    for (const auto& ratio : ratios) {
+        if (ratio.second.state != uint8_t(VaultRatioState::InLiquidation)) {
+            mnview.SetVaultRatio(ratio.first, ratio.second);
+        }
+    }
+    auto vault = mnview.GetVault(liquidate_id);
+    vault->isUnderLiquidation = true;
+    BOOST_REQUIRE(mnview.StoreVault(liquidate_id, *vault));
+
+    BOOST_CHECK(byState(VaultRatioState::Active) == std::set<CVaultId>{active_id});
+    BOOST_CHECK(byState(VaultRatioState::MayLiquidate) == std::set<CVaultId>{next_id});
+    BOOST_CHECK(byState(VaultRatioState::InLiquidation) == std::set<CVaultId>{liquidate_id});
+    BOOST_CHECK(byState(VaultRatioState::Unevaluated).empty());
+
+    auto ratio = mnview.GetVaultRatio(active_id);
+    BOOST_REQUIRE(ratio);
+    BOOST_CHECK_EQUAL(ratio->height, 10);
+    auto colls = mnview.GetLoanCollaterals(active_id, *mnview.GetVaultCollaterals(active_id), 10, 0);
+    BOOST_REQUIRE(colls.ok);
+    BOOST_CHECK_EQUAL(ratio->totalCollaterals, colls.val->totalCollaterals);
+    BOOST_CHECK_EQUAL(ratio->totalLoans, colls.val->totalLoans);
+
+    // changes drop the vault back to unevaluated, liquidation keeps its state
+    BOOST_REQUIRE(mnview.AddVaultCollateral(active_id, {dfi_id, 1 * COIN}));
+    BOOST_REQUIRE(mnview.AddVaultCollateral(liquidate_id, {dfi_id, 1 * COIN}));
+    BOOST_CHECK(byState(VaultRatioState::Active).empty());
+    BOOST_CHECK(byState(VaultRatioState::Unevaluated) == std::set<CVaultId>{active_id});
+    BOOST_CHECK(byState(VaultRatioState::InLiquidation) == std::set<CVaultId>{liquidate_id});
+
+    // scheme updates move the vault between scheme entries
+    BOOST_REQUIRE(mnview.UpdateVault(next_id, CVaultMessage{{}, "sch2"}));
+    BOOST_CHECK(byScheme("sch1") == std::set<CVaultId>{active_id});
+    BOOST_CHECK(byScheme("sch2") == (std::set<CVaultId>{next_id, liquidate_id}));
+    BOOST_CHECK(byState(VaultRatioState::MayLiquidate).empty());
+
+    BOOST_REQUIRE(mnview.EraseVault(next_id));
+    BOOST_CHECK(byScheme("sch2") == std::set<CVaultId>{liquidate_id});
+    BOOST_CHECK(!mnview.GetVaultRatio(next_id));
+    BOOST_CHECK(byState(VaultRatioState::Unevaluated) == std::set<CVaultId>{active_id});
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include <masternodes/oracles.h>
 #include <rpc/rawtransaction_util.h>
 #include <masternodes/masternodes.h>
+#include <masternodes/mn_checks.h>
 
 #include <boost/algorithm/string/join.hpp>
 #include <boost/range/adaptor/transformed.hpp>
@@ -142,4 +143,58 @@ BOOST_FIXTURE_TEST_SUITE(oracles_tests, OraclesTestingSetup)
         BOOST_ASSERT_MSG(dataRes.ok, dataRes.msg.c_str());
     }
 
+    BOOST_AUTO_TEST_CASE(oracle_pair_index_test) {
+
+        COracleId oracleId1{rawVector1};
+        COracleId oracleId2{rawVector2};
+        std::vector<unsigned char> tmp{'a', 'b', 'c'};
+        CScript oracleAddress{tmp.begin(), tmp.end()};
+
+        COracle oracle1;
+        static_cast<CAppointOracleMessage&>(oracle1) = CAppointOracleMessage{oracleAddress, 10, {{"DFI", "USD"}, {"TOK", "USD"}}};
+        COracle oracle2;
+        static_cast<CAppointOracleMessage&>(oracle2) = CAppointOracleMessage{oracleAddress, 30, {{"DFI", "USD"}}};
+
+        CCustomCSView mnview(*pcustomcsview);
+        BOOST_REQUIRE(mnview.AppointOracle(oracleId1, oracle1).ok);
+        BOOST_REQUIRE(mnview.AppointOracle(oracleId2, oracle2).ok);
+
+        auto oraclesOf = [&](const CTokenCurrencyPair& pair) {
+            std::vector<COracleId> result;
+            mnview.ForEachOracleByPair(pair, [&](const COracleId& oracleId) {
+                result.push_back(oracleId);
+                return true;
+            });
+            return JoinOracles(result);
+        };
+        BOOST_CHECK_EQUAL(oraclesOf({"DFI", "USD"}), JoinOracles({oracleId2, oracleId1}));
+        BOOST_CHECK_EQUAL(oraclesOf({"TOK", "USD"}), JoinOracles({oracleId1}));
+        BOOST_CHECK_EQUAL(oraclesOf({"DFI", "EUR"}), JoinOracles({}));
+
+        const int64_t time = 1000000;
+        BOOST_REQUIRE(mnview.SetOracleData(oracleId1, time, {{"DFI", {{"USD", 2 * COIN}}}, {"TOK", {{"USD", COIN}}}}).ok);
+        BOOST_REQUIRE(mnview.SetOracleData(oracleId2, time, {{"DFI", {{"USD", 4 * COIN}}}}).ok);
+
+        // weighted by 10 and 30
+        auto price = GetAggregatePrice(mnview, "DFI", "USD", time);
+        BOOST_REQUIRE(price.ok);
+        BOOST_CHECK_EQUAL(*price.val, 35 * COIN / 10);
+
+        auto prices = GetAggregatePrices(mnview, {{"DFI", "USD"}, {"TOK", "USD"}}, time);
+        BOOST_CHECK_EQUAL(*prices.at({"DFI", "USD"}).val, *price.val);
+        BOOST_CHECK(!prices.at({"TOK", "USD"}).ok); // single live oracle is not enough
+
+        // update moves the oracle between pairs
+        COracle oracle3;
+        static_cast<CAppointOracleMessage&>(oracle3) = CAppointOracleMessage{oracleAddress, 10, {{"TOK", "USD"}, {"DFI", "EUR"}}};
+        BOOST_REQUIRE(mnview.UpdateOracle(oracleId2, std::move(oracle3)).ok);
+        BOOST_CHECK_EQUAL(oraclesOf({"DFI", "USD"}), JoinOracles({oracleId1}));
+        BOOST_CHECK_EQUAL(oraclesOf({"TOK", "USD"}), JoinOracles({oracleId2, oracleId1}));
+        BOOST_CHECK_EQUAL(oraclesOf({"DFI", "EUR"}), JoinOracles({oracleId2}));
+
+        BOOST_REQUIRE(mnview.RemoveOracle(oracleId1).ok);
+        BOOST_CHECK_EQUAL(oraclesOf({"DFI", "USD"}), JoinOracles({}));
+        BOOST_CHECK_EQUAL(oraclesOf({"TOK", "USD"}), JoinOracles({oracleId2}));
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -62,6 +62,15 @@ BOOST_AUTO_TEST_CASE(calc_kernel)
     uint32_t unattainableTarget = 0x00ffffff;
     BOOST_CHECK(!pos::CheckKernelHash(stakeModifier, unattainableTarget, 1, coinstakeTime, 0, mnID, Params().GetConsensus(), {0, 0, 0, 0}, 0, ctxState));
 
+    pos::CKernelSearch kernelSearch(stakeModifier, target, 1, 0, mnID, Params().GetConsensus(), {0, 0, 0, 0}, 0);
+    for (int64_t time = coinstakeTime; time < coinstakeTime + 10; ++time) {
+        BOOST_CHECK(kernelSearch.Hash(time) == pos::CalcKernelHash(stakeModifier, 1, time, mnID));
+        for (uint8_t subNode{0}; subNode < 4; ++subNode) {
+            BOOST_CHECK(kernelSearch.Hash(time, subNode) == pos::CalcKernelHashMulti(stakeModifier, 1, time, mnID, subNode));
+        }
+    }
+    BOOST_CHECK_EQUAL(kernelSearch.HashCount(), 50);
+
 //    CKey key;
 //    key.MakeNewKey(true); // Need to use compressed keys in segwit or the signing will fail
 //    FillableSigningProvider keystore;
@@ -115,6 +115,7 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         pcustomcsDB.reset();
         pcustomcsDB = MakeUnique<CStorageLevelDB>(GetDataDir() / "enhancedcs", nMinDbCache << 20, true, true);
         pcustomcsview = MakeUnique<CCustomCSView>(*pcustomcsDB.get());
+        pcustomcsview->GetStorage().EnableDecodedCache();
 
         panchorauths.reset();
         panchorauths = MakeUnique<CAnchorAuthIndex>();
@@ -137,6 +138,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     nScriptCheckThreads = 3;
     for (int i = 0; i < nScriptCheckThreads - 1; i++)
         threadGroup.create_thread([i]() { return ThreadScriptCheck(i); });
+    for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        threadGroup.create_thread([i]() { return ThreadLiquidationCheck(i); });
+    for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        threadGroup.create_thread([i]() { return ThreadCustomTxCheck(i); });
 
     g_banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
     g_connman = MakeUnique<CConnman>(0x1337, 0x1337); // Deterministic randomness for tests.
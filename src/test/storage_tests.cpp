@@ -6,6 +6,7 @@
 #include <key_io.h>
 #include <masternodes/accountshistory.h>
 #include <masternodes/masternodes.h>
+#include <masternodes/mn_checks.h>
 #include <rpc/rawtransaction_util.h>
 #include <test/setup_common.h>
 
@@ -66,7 +67,8 @@ std::map<TBytes, TBytes> TakeSnapshot(CStorageKV const & storage)
     for(it->Seek(key); it->Valid(); it->Next()) {
         boost::this_thread::interruption_point();
 
-        result.emplace(it->Key(),it->Value());
+        auto rawKey = it->Key(), rawValue = it->Value();
+        result.emplace(TBytes(rawKey.begin(), rawKey.end()), TBytes(rawValue.begin(), rawValue.end()));
     }
     return result;
 }
@@ -125,6 +127,81 @@ BOOST_AUTO_TEST_CASE(undo)
     BOOST_CHECK(snapStart == TakeSnapshot(base_raw));
 }
 
+BOOST_AUTO_TEST_CASE(blockUndo)
+{
+    CStorageKV & base_raw = pcustomcsview->GetStorage();
+    base_raw.Write(ToBytes("testkey1"), ToBytes("value0"));
+    pcustomcsview->SetUndo(UndoKey{2, uint256S("0x1")}, CUndo{});
+
+    auto snapStart = TakeSnapshot(base_raw);
+
+    // per tx and block level undo as left by ConnectBlock
+    CCustomCSView mnview(*pcustomcsview);
+    auto applyTx = [&](uint256 const & txid, std::vector<std::pair<const char *, const char *>> const & writes) {
+        CCustomCSView view(mnview);
+        for (const auto& kv : writes) {
+            BOOST_CHECK(view.GetStorage().Write(ToBytes(kv.first), ToBytes(kv.second)));
+        }
+        auto undo = CUndo::Construct(mnview.GetStorage(), view.GetStorage().GetRaw());
+        view.Flush();
+        mnview.SetUndo(UndoKey{1, txid}, undo);
+        return ::GetSerializeSize(std::make_pair(CUndosView::ByUndoKey::prefix(), UndoKey{1, txid}), PROTOCOL_VERSION)
+             + ::GetSerializeSize(undo, PROTOCOL_VERSION);
+    };
+    // bytes of keys and values
+    size_t perTxSize = 0;
+    perTxSize += applyTx(uint256S("0x1"), {{"testkey1", "value1"}, {"testkey2", "value2"}});
+    perTxSize += applyTx(uint256S("0x2"), {{"testkey1", "value3"}, {"testkey3", "value3"}});
+    perTxSize += applyTx(uint256(), {{"testkey2", "value4"}});
+
+    mnview.CompactBlockUndo(1);
+    BOOST_CHECK(!mnview.GetUndo(UndoKey{1, uint256S("0x1")}));
+    BOOST_CHECK(mnview.GetUndo(UndoKey{2, uint256S("0x1")}));
+    auto blockUndo = mnview.GetBlockUndo(1);
+    BOOST_REQUIRE(blockUndo);
+    BOOST_CHECK_EQUAL(blockUndo->txs.size(), 3);
+    BOOST_CHECK(blockUndo->txs.at(uint256S("0x2")).before.at(ToBytes("testkey1")) == ToBytes("value1"));
+    BOOST_CHECK(!blockUndo->txs.at(uint256S("0x2")).before.at(ToBytes("testkey3")));
+    BOOST_CHECK(blockUndo->txs.at(uint256()).before.at(ToBytes("testkey2")) == ToBytes("value2"));
+    BOOST_CHECK_LT(::GetSerializeSize(std::make_pair(CUndosView::ByBlockUndo::prefix(), BlockUndoKey{1}), PROTOCOL_VERSION)
+                 + ::GetSerializeSize(*blockUndo, PROTOCOL_VERSION), perTxSize);
+    mnview.Flush();
+
+    // disconnect, block level changes first
+    pcustomcsview->OnUndoTx(uint256(), 1, &*blockUndo);
+    pcustomcsview->OnUndoTx(uint256S("0x2"), 1, &*blockUndo);
+    pcustomcsview->OnUndoTx(uint256S("0x1"), 1, &*blockUndo);
+    pcustomcsview->DelBlockUndo(1);
+    BOOST_CHECK(snapStart == TakeSnapshot(base_raw));
+}
+
+BOOST_AUTO_TEST_CASE(pruneUndos)
+{
+    CCustomCSView mnview(*pcustomcsview);
+    CUndo undo;
+    undo.before[ToBytes("testkey1")] = {};
+    // drop undos left by the test chain setup
+    mnview.PruneUndos(1, std::numeric_limits<uint32_t>::max());
+    for (uint32_t height = 1; height <= 5; ++height) {
+        mnview.SetUndo(UndoKey{height, uint256S("0x1")}, undo);
+        mnview.SetUndo(UndoKey{height, uint256S("0x2")}, undo);
+        mnview.SetBlockUndo(height + 10, CBlockCustomUndo{{{uint256S("0x1"), undo}}});
+    }
+
+    BOOST_CHECK_EQUAL(mnview.PruneUndos(4, 2), 4);
+    BOOST_CHECK(!mnview.GetUndo(UndoKey{2, uint256S("0x2")}));
+    BOOST_CHECK(mnview.GetUndo(UndoKey{3, uint256S("0x1")}));
+    BOOST_CHECK_EQUAL(mnview.PruneUndos(4, 2), 2);
+    BOOST_CHECK_EQUAL(mnview.PruneUndos(4, 2), 0);
+    BOOST_CHECK(mnview.GetUndo(UndoKey{4, uint256S("0x1")}));
+
+    BOOST_CHECK_EQUAL(mnview.PruneUndos(14, 2), 6);
+    BOOST_CHECK(!mnview.GetBlockUndo(12));
+    BOOST_CHECK(mnview.GetBlockUndo(13));
+    BOOST_CHECK_EQUAL(mnview.PruneUndos(14, 2), 1);
+    BOOST_CHECK(mnview.GetBlockUndo(14));
+}
+
 BOOST_AUTO_TEST_CASE(recipients)
 {
     auto testChain = interfaces::MakeChain();
@@ -465,4 +542,242 @@ BOOST_AUTO_TEST_CASE(LowerBoundTest)
     }
 }
 
+
+BOOST_AUTO_TEST_CASE(BurnTotals)
+{
+    const auto& burnAddress = Params().GetConsensus().burnAddress;
+    auto fee = CScript() << OP_RETURN;
+
+    {
+        CBurnHistoryStorage burnView(GetDataDir() / "burntotals", 1 << 20, true, true);
+        burnView.InitBurnTotals();
+        burnView.WriteAccountHistory({burnAddress, 100, 1}, {{}, uint8_t(CustomTxType::None), {{DCT_ID{0}, 10 * COIN}}});
+        burnView.WriteAccountHistory({fee, 3000, 2}, {{}, uint8_t(CustomTxType::CreateToken), {{DCT_ID{0}, 5 * COIN}}});
+        burnView.WriteAccountHistory({burnAddress, 6000, 3}, {{}, uint8_t(CustomTxType::PoolSwap), {{DCT_ID{1}, 3 * COIN}}});
+        burnView.WriteAccountHistory({burnAddress, 6001, 1}, {{}, uint8_t(CustomTxType::AccountToAccount), {{DCT_ID{2}, 2 * COIN}, {DCT_ID{3}, -COIN}}});
+        BOOST_REQUIRE(burnView.Flush());
+
+        auto totals = burnView.GetBurnTotals();
+        BOOST_CHECK_EQUAL(totals.utxoBurn, 10 * COIN);
+        BOOST_CHECK_EQUAL(totals.feeBurn, 5 * COIN);
+        BOOST_CHECK(totals.dexFeeBurn == (TAmounts{{DCT_ID{1}, 3 * COIN}}));
+        BOOST_CHECK(totals.tokenBurn == (TAmounts{{DCT_ID{2}, 2 * COIN}}));
+
+        totals = burnView.GetBurnTotals(2999);
+        BOOST_CHECK_EQUAL(totals.utxoBurn, 10 * COIN);
+        BOOST_CHECK_EQUAL(totals.feeBurn, 0);
+        totals = burnView.GetBurnTotals(6000);
+        BOOST_CHECK_EQUAL(totals.feeBurn, 5 * COIN);
+        BOOST_CHECK(totals.dexFeeBurn == (TAmounts{{DCT_ID{1}, 3 * COIN}}));
+        BOOST_CHECK(totals.tokenBurn.empty());
+
+        // disconnect the last two blocks
+        burnView.EraseAccountHistory({burnAddress, 6001, 1});
+        burnView.EraseAccountHistory({burnAddress, 6000, 3});
+        BOOST_REQUIRE(burnView.Flush());
+
+        totals = burnView.GetBurnTotals();
+        BOOST_CHECK_EQUAL(totals.feeBurn, 5 * COIN);
+        BOOST_CHECK(totals.dexFeeBurn.empty());
+        BOOST_CHECK(totals.tokenBurn.empty());
+        BOOST_CHECK_EQUAL(burnView.GetBurnTotals(6001).feeBurn, 5 * COIN);
+    }
+
+    // totals are built from history written before the index existed
+    CBurnHistoryStorage burnView(GetDataDir() / "burntotals", 1 << 20, true, true);
+    burnView.CAccountsHistoryView::WriteAccountHistory({burnAddress, 100, 1}, {{}, uint8_t(CustomTxType::None), {{DCT_ID{0}, 10 * COIN}}});
+    burnView.CAccountsHistoryView::WriteAccountHistory({fee, 3000, 2}, {{}, uint8_t(CustomTxType::Vault), {{DCT_ID{0}, 5 * COIN}}});
+    BOOST_REQUIRE(burnView.Flush());
+    burnView.InitBurnTotals();
+
+    BOOST_CHECK_EQUAL(burnView.GetBurnTotals().utxoBurn, 10 * COIN);
+    BOOST_CHECK_EQUAL(burnView.GetBurnTotals().feeBurn, 5 * COIN);
+    BOOST_CHECK_EQUAL(burnView.GetBurnTotals(2999).feeBurn, 0);
+    BOOST_CHECK_EQUAL(burnView.GetBurnTotals(3000).feeBurn, 5 * COIN);
+}
+
+BOOST_AUTO_TEST_CASE(AccountHistoryIndexes)
+{
+    const auto alice = CScript() << OP_1;
+    const auto bob = CScript() << OP_2;
+    CAccountHistoryStorage historyView(GetDataDir() / "historyindexes", 1 << 20, true, true);
+
+    // history written before the indexes were enabled
+    historyView.WriteAccountHistory({alice, 10, 1}, {uint256S("0x1"), uint8_t(CustomTxType::AccountToAccount), {{DCT_ID{1}, COIN}}});
+    BOOST_REQUIRE(historyView.Flush());
+    historyView.InitHistoryIndexes(true);
+
+    historyView.WriteAccountHistory({alice, 12, 1}, {uint256S("0x2"), uint8_t(CustomTxType::PoolSwap), {{DCT_ID{0}, -COIN}, {DCT_ID{1}, COIN}}});
+    historyView.WriteAccountHistory({alice, 13, 2}, {uint256S("0x3"), uint8_t(CustomTxType::AccountToAccount), {{DCT_ID{0}, COIN}}});
+    historyView.WriteAccountHistory({bob, 12, 2}, {uint256S("0x4"), uint8_t(CustomTxType::AccountToAccount), {{DCT_ID{1}, -COIN}}});
+    BOOST_REQUIRE(historyView.Flush());
+
+    auto collect = [](std::vector<uint256>& txids) {
+        return [&txids](AccountHistoryKey const &, CLazySerialize<AccountHistoryValue> valueLazy) {
+            txids.push_back(valueLazy.get().txid);
+            return true;
+        };
+    };
+
+    std::vector<uint256> txids;
+    historyView.ForEachAccountHistoryByToken(DCT_ID{1}, collect(txids));
+    BOOST_CHECK(txids == (std::vector<uint256>{uint256S("0x2"), uint256S("0x1"), uint256S("0x4")}));
+
+    txids.clear();
+    historyView.ForEachAccountHistoryByType(uint8_t(CustomTxType::AccountToAccount), collect(txids), {alice, 12, std::numeric_limits<uint32_t>::max()});
+    BOOST_CHECK(txids == (std::vector<uint256>{uint256S("0x1"), uint256S("0x4")}));
+
+    // disconnect
+    historyView.EraseAccountHistory({alice, 12, 1});
+    BOOST_REQUIRE(historyView.Flush());
+    txids.clear();
+    historyView.ForEachAccountHistoryByToken(DCT_ID{0}, collect(txids));
+    BOOST_CHECK(txids == (std::vector<uint256>{uint256S("0x3")}));
+    txids.clear();
+    historyView.ForEachAccountHistoryByType(uint8_t(CustomTxType::PoolSwap), collect(txids));
+    BOOST_CHECK(txids.empty());
+
+    // disabled indexes are dropped and rebuilt on the next enable
+    historyView.InitHistoryIndexes(false);
+    historyView.WriteAccountHistory({bob, 14, 1}, {uint256S("0x5"), uint8_t(CustomTxType::PoolSwap), {{DCT_ID{2}, COIN}}});
+    BOOST_REQUIRE(historyView.Flush());
+    historyView.InitHistoryIndexes(true);
+    txids.clear();
+    historyView.ForEachAccountHistoryByToken(DCT_ID{2}, collect(txids));
+    BOOST_CHECK(txids == (std::vector<uint256>{uint256S("0x5")}));
+}
+
+BOOST_AUTO_TEST_CASE(TrackReads)
+{
+    pcustomcsview->WriteBy<TestForward>(TestForward{1}, 1);
+    pcustomcsview->WriteBy<TestForward>(TestForward{2}, 2);
+
+    CStorageReadSet reads;
+    CCustomCSView view(*pcustomcsview);
+    view.GetStorage().TrackReads(&reads);
+
+    int value;
+    BOOST_CHECK(view.ReadBy<TestForward>(TestForward{1}, value));
+    BOOST_CHECK(!view.ExistsBy<TestForward>(TestForward{3}));
+    // own writes are not reads from the layer below
+    view.WriteBy<TestForward>(TestForward{4}, 4);
+    BOOST_CHECK(view.ReadBy<TestForward>(TestForward{4}, value));
+    BOOST_CHECK_EQUAL(reads.keys.size(), 2);
+    BOOST_CHECK(reads.keys.count(DbTypeToBytes(std::make_pair(TestForward::prefix(), TestForward{1}))));
+    BOOST_CHECK(reads.prefixes.empty());
+
+    view.ForEach<TestBackward, TestBackward, int>([&](TestBackward const &, int) {
+        return true;
+    });
+    BOOST_CHECK(reads.prefixes == std::set<uint8_t>{TestBackward::prefix()});
+
+    view.GetStorage().TrackReads(nullptr);
+    view.ReadBy<TestForward>(TestForward{2}, value);
+    BOOST_CHECK_EQUAL(reads.keys.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(UndoConstruct)
+{
+    auto key = [](uint32_t n) {
+        return DbTypeToBytes(std::make_pair(TestForward::prefix(), TestForward{n}));
+    };
+    for (uint32_t n = 1; n <= 3; ++n) {
+        pcustomcsview->WriteBy<TestForward>(TestForward{n}, n);
+    }
+    CCustomCSView block(*pcustomcsview);
+    block.EraseBy<TestForward>(TestForward{2});
+    block.WriteBy<TestForward>(TestForward{5}, 5);
+
+    CStorageReadSet reads;
+    block.GetStorage().TrackReads(&reads);
+
+    CCustomCSView tx(block);
+    for (uint32_t n = 1; n <= 5; ++n) {
+        if (n == 3) {
+            tx.EraseBy<TestForward>(TestForward{n});
+        } else {
+            tx.WriteBy<TestForward>(TestForward{n}, n * 10);
+        }
+    }
+    auto undo = CUndo::Construct(block.GetStorage(), tx.GetStorage().GetRaw());
+    BOOST_REQUIRE_EQUAL(undo.before.size(), 5);
+    BOOST_CHECK(undo.before[key(1)] == DbTypeToBytes(1));
+    BOOST_CHECK(!undo.before[key(2)]);
+    BOOST_CHECK(undo.before[key(3)] == DbTypeToBytes(3));
+    BOOST_CHECK(!undo.before[key(4)]);
+    BOOST_CHECK(undo.before[key(5)] == DbTypeToBytes(5));
+
+    // only the keys the block layer doesn't hold are reads from below, as with point reads
+    BOOST_CHECK(reads.keys == (std::set<TBytes>{key(1), key(3), key(4)}));
+    BOOST_CHECK(reads.prefixes.empty());
+    BOOST_CHECK(block.GetStorage().GetReadSet() == &reads);
+    block.GetStorage().TrackReads(nullptr);
+
+    tx.Flush();
+    CUndo::Revert(block.GetStorage(), undo);
+    int value;
+    BOOST_CHECK(block.ReadBy<TestForward>(TestForward{1}, value) && value == 1);
+    BOOST_CHECK(!block.ExistsBy<TestForward>(TestForward{2}));
+    BOOST_CHECK(block.ReadBy<TestForward>(TestForward{3}, value) && value == 3);
+    BOOST_CHECK(!block.ExistsBy<TestForward>(TestForward{4}));
+    BOOST_CHECK(block.ReadBy<TestForward>(TestForward{5}, value) && value == 5);
+}
+
+BOOST_AUTO_TEST_CASE(DecodedCache)
+{
+    auto cache = pcustomcsview->GetStorage().GetDecodedCache();
+    BOOST_REQUIRE(cache);
+    auto start = cache->GetStats();
+
+    pcustomcsview->WriteBy<TestForward>(TestForward{1}, 1);
+
+    auto read = [](CCustomCSView& view, uint32_t n) {
+        int value = -1;
+        view.ReadCachedBy<TestForward>(TestForward{n}, value);
+        return value;
+    };
+
+    // absent keys are cached too
+    BOOST_CHECK_EQUAL(read(*pcustomcsview, 1), 1);
+    BOOST_CHECK_EQUAL(read(*pcustomcsview, 1), 1);
+    BOOST_CHECK_EQUAL(read(*pcustomcsview, 2), -1);
+    BOOST_CHECK_EQUAL(read(*pcustomcsview, 2), -1);
+    auto stats = cache->GetStats();
+    BOOST_CHECK_EQUAL(stats.hits - start.hits, 2);
+    BOOST_CHECK_EQUAL(stats.misses - start.misses, 2);
+
+    {
+        // nested views read their own writes before the cache
+        CCustomCSView view(*pcustomcsview);
+        view.WriteBy<TestForward>(TestForward{1}, 10);
+        BOOST_CHECK_EQUAL(read(view, 1), 10);
+        BOOST_CHECK_EQUAL(read(*pcustomcsview, 1), 1);
+
+        CCustomCSView nested(view);
+        nested.WriteBy<TestForward>(TestForward{2}, 20);
+        BOOST_CHECK(nested.Flush());
+        BOOST_CHECK_EQUAL(read(view, 2), 20);
+        BOOST_CHECK_EQUAL(read(*pcustomcsview, 2), -1);
+
+        // undo is written through the same layers
+        auto undo = CUndo::Construct(pcustomcsview->GetStorage(), view.GetStorage().GetRaw());
+        BOOST_CHECK(view.Flush());
+        pcustomcsview->SetUndo(UndoKey{1, uint256S("0x1")}, undo);
+    }
+
+    // flushes into the cached layer drop its stale entries
+    BOOST_CHECK_EQUAL(read(*pcustomcsview, 1), 10);
+    BOOST_CHECK_EQUAL(read(*pcustomcsview, 2), 20);
+
+    pcustomcsview->OnUndoTx(uint256S("0x1"), 1);
+    BOOST_CHECK_EQUAL(read(*pcustomcsview, 1), 1);
+    BOOST_CHECK_EQUAL(read(*pcustomcsview, 2), -1);
+
+    // discarding the layer drops every entry
+    pcustomcsview->WriteBy<TestForward>(TestForward{3}, 3);
+    BOOST_CHECK_EQUAL(read(*pcustomcsview, 3), 3);
+    pcustomcsview->Discard();
+    BOOST_CHECK_EQUAL(cache->GetStats().entries, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
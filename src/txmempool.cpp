@@ -335,6 +335,7 @@ CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator)
     nCheckFrequency = 0;
     accountsViewDirty = false;
     forceRebuildForReorg = false;
+    accountsChangesUnknown = false;
 }
 
 bool CTxMemPool::isSpent(const COutPoint& outpoint) const
@@ -568,7 +569,7 @@ CCustomCSView& CTxMemPool::accountsView()
 /**
  * Called when a block is connected. Removes from mempool and updates the miner fee estimator.
  */
-void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight)
+void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight, const std::set<TBytes>* changedKeys)
 {
     AssertLockHeld(cs);
 
@@ -592,6 +593,11 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
     }
 
     if (pcustomcsview) {
+        if (!changedKeys) {
+            accountsChangesUnknown = true;
+        } else if (!accountsFootprints.empty()) {
+            accountsChangedKeys.insert(changedKeys->begin(), changedKeys->end());
+        }
         accountsViewDirty |= forceRebuildForReorg;
         rebuildAccountsView(nBlockHeight, &::ChainstateActive().CoinsTip());
     }
@@ -613,6 +619,9 @@ void CTxMemPool::_clear()
     rollingMinimumFeeRate = 0;
     accountsViewDirty = false;
     forceRebuildForReorg = false;
+    accountsFootprints.clear();
+    accountsChangedKeys.clear();
+    accountsChangesUnknown = false;
     ++nTransactionsUpdated;
 }
 
@@ -948,6 +957,16 @@ void CTxMemPool::RemoveStaged(const setEntries &stage, bool updateDescendants, M
     AssertLockHeld(cs);
     UpdateForRemoveFromMempool(stage, updateDescendants);
     for (txiter it : stage) {
+        // effects of a removed transaction vanish from under the ones applied after it
+        auto footprint = accountsFootprints.find(it->GetTx().GetHash());
+        if (footprint != accountsFootprints.end()) {
+            for (const auto& write : footprint->second.writes) {
+                accountsChangedKeys.insert(write.first);
+            }
+            accountsFootprints.erase(footprint);
+        } else {
+            accountsChangesUnknown = true;
+        }
         removeUnchecked(it, reason);
     }
     accountsViewDirty |= !stage.empty();
@@ -1100,8 +1119,21 @@ void CTxMemPool::rebuildAccountsView(int height, const CCoinsViewCache& coinsCac
     accountsView().Discard();
     CCustomCSView viewDuplicate(accountsView());
 
+    const auto reapplyAll = forceRebuildForReorg || accountsChangesUnknown;
+
+    // A transaction reading nothing that changed keeps its previous effects
+    auto isAffected = [&](const AccountsFootprint& footprint) {
+        return footprint.reads.Conflicts(accountsChangedKeys);
+    };
+    auto addChangedKeys = [&](const AccountsFootprint& footprint) {
+        for (const auto& write : footprint.writes) {
+            accountsChangedKeys.insert(write.first);
+        }
+    };
+
     setEntries staged;
     std::vector<CTransactionRef> vtx;
+    size_t reapplied{0};
     // Check custom TX consensus types are now not in conflict with account layer
     auto& txsByEntryTime = mapTx.get<entry_time>();
     for (auto it = txsByEntryTime.begin(); it != txsByEntryTime.end(); ++it) {
@@ -1113,12 +1145,45 @@ void CTxMemPool::rebuildAccountsView(int height, const CCoinsViewCache& coinsCac
             vtx.push_back(it->GetSharedTx());
             continue;
         }
-        auto res = ApplyCustomTx(viewDuplicate, coinsCache, tx, Params().GetConsensus(), height);
+
+        auto previous = accountsFootprints.find(tx.GetHash());
+        if (!reapplyAll && previous != accountsFootprints.end() && !isAffected(previous->second)) {
+            auto& storage = viewDuplicate.GetStorage();
+            for (const auto& write : previous->second.writes) {
+                if (write.second) {
+                    storage.Write(write.first, *write.second);
+                } else {
+                    storage.Erase(write.first);
+                }
+            }
+            continue;
+        }
+
+        ++reapplied;
+        AccountsFootprint footprint;
+        CCustomCSView txView(viewDuplicate);
+        txView.GetStorage().TrackReads(&footprint.reads);
+        auto res = ApplyCustomTx(txView, coinsCache, tx, Params().GetConsensus(), height);
+        txView.GetStorage().TrackReads(nullptr);
+
+        // old and new effects both differ from what later transactions read
+        if (previous != accountsFootprints.end()) {
+            addChangedKeys(previous->second);
+            accountsFootprints.erase(previous);
+        }
         if (!res && (res.code & CustomTxErrCodes::Fatal)) {
             LogPrintf("%s: Remove conflicting custom TX: %s\n", __func__, tx.GetHash().GetHex());
             staged.insert(mapTx.project<0>(it));
             vtx.push_back(it->GetSharedTx());
+            continue;
         }
+        for (const auto& write : txView.GetStorage().GetRaw()) {
+            footprint.writes.emplace(TBytes(write.first.begin(), write.first.end()),
+                                     write.second ? TBytes(write.second->begin(), write.second->end()) : Optional<TBytes>{});
+        }
+        addChangedKeys(footprint);
+        accountsFootprints.emplace(tx.GetHash(), std::move(footprint));
+        txView.Flush();
     }
 
     RemoveStaged(staged, true, MemPoolRemovalReason::BLOCK);
@@ -1128,9 +1193,30 @@ void CTxMemPool::rebuildAccountsView(int height, const CCoinsViewCache& coinsCac
         ClearPrioritisation(tx->GetHash());
     }
 
+    LogPrint(BCLog::MEMPOOL, "%s: %u of %u transactions applied again\n", __func__, reapplied, mapTx.size());
+
     viewDuplicate.Flush();
     accountsViewDirty = false;
     forceRebuildForReorg = false;
+    accountsChangedKeys.clear();
+    accountsChangesUnknown = false;
+}
+
+void CTxMemPool::setAccountsFootprint(const uint256& txid, CStorageReadSet&& reads, const MapKV& writes)
+{
+    AccountsFootprint footprint;
+    footprint.reads = std::move(reads);
+    for (const auto& write : writes) {
+        footprint.writes.emplace(TBytes(write.first.begin(), write.first.end()),
+                                 write.second ? TBytes(write.second->begin(), write.second->end()) : Optional<TBytes>{});
+    }
+    accountsFootprints[txid] = std::move(footprint);
+}
+
+void CTxMemPool::resetAccountsFootprints()
+{
+    accountsFootprints.clear();
+    accountsChangedKeys.clear();
 }
 
 uint64_t CTxMemPool::CalculateDescendantMaximum(txiter entry) const {
@@ -17,6 +17,7 @@
 #include <amount.h>
 #include <coins.h>
 #include <crypto/siphash.h>
+#include <flushablestorage.h>
 #include <indirectmap.h>
 #include <policy/feerate.h>
 #include <primitives/transaction.h>
@@ -551,6 +552,17 @@ private:
     bool accountsViewDirty;
     bool forceRebuildForReorg;
     std::unique_ptr<CCustomCSView> acview;
+
+    /** What a transaction read from and wrote to the accounts view when last applied */
+    struct AccountsFootprint {
+        CStorageReadSet reads;
+        std::map<TBytes, Optional<TBytes>> writes;
+    };
+    std::map<uint256, AccountsFootprint> accountsFootprints;
+    //! Keys changed under the applied transactions since the accounts view was last rebuilt
+    std::set<TBytes> accountsChangedKeys;
+    //! Changes are not fully known, every transaction has to be applied again
+    bool accountsChangesUnknown;
 public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx GUARDED_BY(cs);
     std::map<uint256, CAmount> mapDeltas;
@@ -583,7 +595,7 @@ public:
     void removeRecursive(const CTransaction& tx, MemPoolRemovalReason reason) EXCLUSIVE_LOCKS_REQUIRED(cs);
     void removeForReorg(const CCoinsViewCache* pcoins, unsigned int nMemPoolHeight, int flags) EXCLUSIVE_LOCKS_REQUIRED(cs, cs_main);
     void removeConflicts(const CTransaction& tx) EXCLUSIVE_LOCKS_REQUIRED(cs);
-    void removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight, const std::set<TBytes>* changedKeys = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     void clear();
     void _clear() EXCLUSIVE_LOCKS_REQUIRED(cs); //lock free
@@ -707,6 +719,9 @@ public:
 
     CCustomCSView& accountsView();
     void rebuildAccountsView(int height, const CCoinsViewCache& coinsCache);
+    void setAccountsFootprint(const uint256& txid, CStorageReadSet&& reads, const MapKV& writes);
+    //! Accounts state changed in ways not reported to removeForBlock, next rebuild applies every transaction
+    void resetAccountsFootprints();
 private:
     /** UpdateForDescendants is used by UpdateTransactionsFromBlock to update
      *  the descendants for a single transaction that has been added to the
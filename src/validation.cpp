@@ -135,6 +135,7 @@ bool fCheckBlockIndex = false;
 size_t nCoinCacheUsage = 5000 * 300;
 size_t nCustomMemUsage = nDefaultDbCache << 10;
 uint64_t nPruneTarget = 0;
+uint32_t nCustomUndoDepth = 0;
 bool fIsFakeNet = false;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 
@@ -153,6 +154,46 @@ CScript COINBASE_FLAGS;
 TBytes compactBegin;
 TBytes compactEnd;
 
+static void ExtendCompactRange(const MapKV& map)
+{
+    if (map.empty()) {
+        return;
+    }
+    TBytes begin(map.begin()->first.begin(), map.begin()->first.end());
+    TBytes end(map.rbegin()->first.begin(), map.rbegin()->first.end());
+    if (compactBegin.empty() || begin < compactBegin) {
+        compactBegin = std::move(begin);
+    }
+    if (compactEnd.empty() || end > compactEnd) {
+        compactEnd = std::move(end);
+    }
+}
+
+// ranges waiting for the background compaction thread
+static boost::mutex cs_undoCompaction;
+static boost::condition_variable cvUndoCompaction;
+static TBytes undoCompactBegin;
+static TBytes undoCompactEnd;
+
+void ThreadCustomUndoCompaction()
+{
+    ScheduleBatchPriority();
+    while (true) {
+        TBytes begin, end;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_undoCompaction);
+            while (undoCompactBegin.empty()) {
+                cvUndoCompaction.wait(lock);
+            }
+            begin.swap(undoCompactBegin);
+            end.swap(undoCompactEnd);
+        }
+        auto time = GetTimeMillis();
+        pcustomcsDB->Compact(begin, end);
+        LogPrint(BCLog::BENCH, "    - Background DB compacting takes: %dms\n", GetTimeMillis() - time);
+    }
+}
+
 // Internal stuff
 namespace {
     CBlockIndex* pindexBestInvalid = nullptr;
@@ -571,6 +612,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         CCoinsView dummy;
         CCoinsViewCache view(&dummy);
         CCustomCSView mnview(pool.accountsView());
+        CStorageReadSet mnviewReads;
 
         LockPoints lp;
         CCoinsViewCache& coins_cache = ::ChainstateActive().CoinsTip();
@@ -616,6 +658,9 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         // rebuild accounts view if dirty
         pool.rebuildAccountsView(height, view);
 
+        // what the transaction reads decides whether it has to be applied again after a block
+        mnview.GetStorage().TrackReads(&mnviewReads);
+
         CAmount nFees = 0;
         if (!Consensus::CheckTxInputs(tx, state, view, &mnview, height, nFees, chainparams)) {
             return error("%s: Consensus::CheckTxInputs: %s, %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
@@ -912,6 +957,8 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
 
         // Store transaction in memory
         pool.addUnchecked(entry, setAncestors, validForFeeEstimation);
+        mnview.GetStorage().TrackReads(nullptr);
+        pool.setAccountsFootprint(hash, std::move(mnviewReads), mnview.GetStorage().GetRaw());
         mnview.Flush();
 
         // trim mempool and check if tx was trimmed
@@ -1662,8 +1709,12 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         return DISCONNECT_FAILED;
     }
 
+    // blocks connected before compact undo keep one undo record per tx
+    const auto customBlockUndo = mnview.GetBlockUndo(pindex->nHeight);
+    const auto customBlockUndoPtr = customBlockUndo ? &*customBlockUndo : nullptr;
+
     // special case: possible undo (first) of custom 'complex changes' for the whole block (expired orders and/or prices)
-    mnview.OnUndoTx(uint256(), (uint32_t) pindex->nHeight); // undo for "zero hash"
+    mnview.OnUndoTx(uint256(), (uint32_t) pindex->nHeight, customBlockUndoPtr); // undo for "zero hash"
 
     if (pindex->nHeight >= Params().GetConsensus().FortCanningHeight) {
         // erase auction fee history
@@ -1782,7 +1833,7 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         }
 
         // process transactions revert for masternodes
-        mnview.OnUndoTx(tx.GetHash(), (uint32_t) pindex->nHeight);
+        mnview.OnUndoTx(tx.GetHash(), (uint32_t) pindex->nHeight, customBlockUndoPtr);
         CHistoryErasers erasers{paccountHistoryDB.get(), pburnHistoryDB.get(), pvaultHistoryDB.get()};
         auto res = RevertCustomTx(mnview, view, tx, Params().GetConsensus(), (uint32_t) pindex->nHeight, i, erasers);
         if (!res) {
@@ -1790,6 +1841,10 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         }
     }
 
+    if (customBlockUndo) {
+        mnview.DelBlockUndo(pindex->nHeight);
+    }
+
     // one time downgrade to revert CInterestRateV2 structure
     if (pindex->nHeight == Params().GetConsensus().FortCanningHillHeight) {
         auto time = GetTimeMillis();
@@ -1892,6 +1947,20 @@ void ThreadScriptCheck(int worker_num) {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CLiquidationCheck> liquidationcheckqueue(128);
+
+void ThreadLiquidationCheck(int worker_num) {
+    util::ThreadRename(strprintf("liqcheck.%i", worker_num));
+    liquidationcheckqueue.Thread();
+}
+
+static CCheckQueue<CCustomTxCheck> customtxcheckqueue(128);
+
+void ThreadCustomTxCheck(int worker_num) {
+    util::ThreadRename(strprintf("customtx.%i", worker_num));
+    customtxcheckqueue.Thread();
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -2498,6 +2567,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // it's used for account changes by the block
     // to calculate their merkle root in isolation
     CCustomCSView accountsView(mnview);
+    // custom txs are applied ahead on the worker queue and committed in block order below
+    CCustomTxExecutor customTxs(accountsView, view, block, chainparams.GetConsensus(), pindex->nHeight, pindex->GetBlockTime(), nScriptCheckThreads && !getenv("DEFI_NOSPEC") ? &customtxcheckqueue : nullptr);
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
@@ -2571,7 +2642,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             }
 
             CHistoryWriters writers{paccountHistoryDB.get(), pburnHistoryDB.get(), pvaultHistoryDB.get()};
-            const auto res = ApplyCustomTx(accountsView, view, tx, chainparams.GetConsensus(), pindex->nHeight, pindex->GetBlockTime(), i, &writers);
+            const auto res = customTxs.Apply(i, &writers);
             if (!res.ok && (res.code & CustomTxErrCodes::Fatal)) {
                 if (pindex->nHeight >= chainparams.GetConsensus().EunosHeight) {
                     return state.Invalid(ValidationInvalidReason::CONSENSUS,
@@ -2599,6 +2670,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 if (!fJustCheck) {
                     LogPrint(BCLog::ANCHORING, "%s: connecting finalization tx: %s block: %d\n", __func__, tx.GetHash().GetHex(), pindex->nHeight);
                 }
+                customTxs.Invalidate();
                 ResVal<uint256> res = ApplyAnchorRewardTxPlus(mnview, tx, pindex->nHeight, metadata, chainparams.GetConsensus());
                 if (!res.ok) {
                     return state.Invalid(ValidationInvalidReason::CONSENSUS,
@@ -2613,6 +2685,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 if (!fJustCheck) {
                     LogPrint(BCLog::ANCHORING, "%s: connecting finalization tx: %s block: %d\n", __func__, tx.GetHash().GetHex(), pindex->nHeight);
                 }
+                customTxs.Invalidate();
                 ResVal<uint256> res = ApplyAnchorRewardTx(mnview, tx, pindex->nHeight, pindex->pprev ? pindex->pprev->stakeModifier : uint256(), metadata, chainparams.GetConsensus());
                 if (!res.ok) {
                     return state.Invalid(ValidationInvalidReason::CONSENSUS,
@@ -2643,6 +2716,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
+    if (getenv("DEFI_SPECLOG")) fprintf(stderr, "spec %zu %zu\n", customTxs.Speculated(), customTxs.Committed());
+    LogPrint(BCLog::BENCH, "      - Custom txs applied ahead: %u, committed: %u\n", customTxs.Speculated(), customTxs.Committed());
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
     // chek main coinbase
@@ -2869,6 +2944,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         }
     }
     mnview.SetLastHeight(pindex->nHeight);
+    mnview.CompactBlockUndo(pindex->nHeight);
 
     auto &checkpoints = chainparams.Checkpoints().mapCheckpoints;
     auto it = checkpoints.lower_bound(pindex->nHeight);
@@ -2887,10 +2963,18 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             }
             return pruned.DelUndo(key).ok;
         });
+        mnview.ForEachBlockUndo([&](BlockUndoKey const & key, CLazySerialize<CBlockCustomUndo>) {
+            if (key.height >= it->first) { // don't erase checkpoint height
+                return false;
+            }
+            if (!pruneStarted) {
+                pruneStarted = true;
+                LogPrintf("Pruning undo data prior %d, it can take a while...\n", it->first);
+            }
+            return pruned.DelBlockUndo(key.height).ok;
+        });
         if (pruneStarted) {
-            auto& map = pruned.GetStorage().GetRaw();
-            compactBegin = map.begin()->first;
-            compactEnd = map.rbegin()->first;
+            ExtendCompactRange(pruned.GetStorage().GetRaw());
             pruned.Flush();
             LogPrintf("Pruning undo data finished.\n");
             LogPrint(BCLog::BENCH, "    - Pruning undo data takes: %dms\n", GetTimeMillis() - time);
@@ -2906,6 +2990,15 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         }
     }
 
+    // rolling pruning, a few blocks at a time to not stall connecting
+    if (nCustomUndoDepth && static_cast<uint32_t>(pindex->nHeight) > nCustomUndoDepth) {
+        CCustomCSView pruned(mnview);
+        if (pruned.PruneUndos(pindex->nHeight - nCustomUndoDepth, CUSTOM_UNDO_PRUNE_BLOCKS)) {
+            ExtendCompactRange(pruned.GetStorage().GetRaw());
+            pruned.Flush();
+        }
+    }
+
     int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5 - nTime4), nTimeIndex * MICRO, nTimeIndex * MILLI / nBlocksTotal);
 
@@ -3107,23 +3200,26 @@ void CChainState::ProcessLoanEvents(const CBlockIndex* pindex, CCustomCSView& ca
     }
 
     if (pindex->nHeight % chainparams.GetConsensus().blocksCollateralizationRatioCalculation() == 0) {
-        bool useNextPrice = false, requireLivePrice = true;
-        LogPrint(BCLog::LOAN,"ProcessLoanEvents()->ForEachVaultCollateral():\n"); /* Continued */
+        LogPrint(BCLog::LOAN,"ProcessLoanEvents()->GetLiquidationCandidates():\n"); /* Continued */
 
-        cache.ForEachVaultCollateral([&](const CVaultId& vaultId, const CBalances& collaterals) {
-            auto collateral = cache.GetLoanCollaterals(vaultId, collaterals, pindex->nHeight, pindex->nTime, useNextPrice, requireLivePrice);
-            if (!collateral) {
-                return true;
+        // Evaluation only reads state and a liquidation touches nothing but its own vault,
+        // so evaluating every vault first, in parallel, and applying afterwards gives the same result
+        std::vector<std::pair<CVaultId, CVaultRatio>> ratios;
+        auto candidates = cache.GetLiquidationCandidates(pindex->nHeight, pindex->nTime, nScriptCheckThreads ? &liquidationcheckqueue : nullptr, &ratios);
+
+        // Liquidated vaults are moved to their own state when stored below
+        for (const auto& ratio : ratios) {
+            if (ratio.second.state != uint8_t(VaultRatioState::InLiquidation)) {
+                cache.SetVaultRatio(ratio.first, ratio.second);
             }
+        }
+        for (const auto& candidate : candidates) {
+            const auto& vaultId = candidate.vaultId;
+            const auto& collaterals = candidate.collaterals;
+            const auto& collateral = candidate.collateral;
 
             auto vault = cache.GetVault(vaultId);
             assert(vault);
-            auto scheme = cache.GetLoanScheme(vault->schemeId);
-            assert(scheme);
-            if (scheme->ratio <= collateral.val->ratio()) {
-                // All good, within ratio, nothing more to do.
-                return true;
-            }
 
             // Time to liquidate vault.
             vault->isUnderLiquidation = true;
@@ -3162,7 +3258,7 @@ void CChainState::ProcessLoanEvents(const CBlockIndex* pindex, CCustomCSView& ca
                 cache.SubVaultCollateral(vaultId, {tokenId, tokenValue});
             }
 
-            auto batches = CollectAuctionBatches(*collateral.val, collaterals.balances, loanTokens->balances);
+            auto batches = CollectAuctionBatches(collateral, collaterals.balances, loanTokens->balances);
 
             // Now, let's add the remaining amounts and store the batch.
             for (auto i = 0u; i < batches.size(); i++) {
@@ -3186,11 +3282,9 @@ void CChainState::ProcessLoanEvents(const CBlockIndex* pindex, CCustomCSView& ca
 
             // Store state in vault DB
             if (pvaultHistoryDB) {
-                pvaultHistoryDB->WriteVaultState(cache, *pindex, vaultId, collateral.val->ratio());
+                pvaultHistoryDB->WriteVaultState(cache, *pindex, vaultId, collateral.ratio());
             }
-
-            return true;
-        });
+        }
     }
 
     CHistoryWriters writers{nullptr, pburnHistoryDB.get(), pvaultHistoryDB.get()};
@@ -3292,7 +3386,16 @@ void CChainState::ProcessOracleEvents(const CBlockIndex* pindex, CCustomCSView&
     if (pindex->nHeight % blockInterval != 0) {
         return;
     }
+    std::vector<CFixedIntervalPrice> fixedIntervalPrices;
+    std::set<CTokenCurrencyPair> priceFeeds;
     cache.ForEachFixedIntervalPrice([&](const CTokenCurrencyPair&, CFixedIntervalPrice fixedIntervalPrice){
+        priceFeeds.insert(fixedIntervalPrice.priceFeedId);
+        fixedIntervalPrices.push_back(std::move(fixedIntervalPrice));
+        return true;
+    });
+    // aggregate all feeds in one batch, oracles shared between feeds are read once
+    const auto aggregatePrices = GetAggregatePrices(cache, priceFeeds, pindex->nTime);
+    for (auto& fixedIntervalPrice : fixedIntervalPrices) {
         // Ensure that we update active and next regardless of state of things
         // And SetFixedIntervalPrice on each evaluation of this block.
 
@@ -3314,10 +3417,7 @@ void CChainState::ProcessOracleEvents(const CBlockIndex* pindex, CCustomCSView&
         fixedIntervalPrice.timestamp = pindex->nTime;
         // Use -1 to indicate empty price
         fixedIntervalPrice.priceRecord[1] = -1;
-        auto aggregatePrice = GetAggregatePrice(cache,
-                                                fixedIntervalPrice.priceFeedId.first,
-                                                fixedIntervalPrice.priceFeedId.second,
-                                                pindex->nTime);
+        const auto& aggregatePrice = aggregatePrices.at(fixedIntervalPrice.priceFeedId);
         if (aggregatePrice) {
             fixedIntervalPrice.priceRecord[1] = aggregatePrice;
         } else {
@@ -3327,8 +3427,7 @@ void CChainState::ProcessOracleEvents(const CBlockIndex* pindex, CCustomCSView&
         if (!res) {
             LogPrintf("Error: SetFixedIntervalPrice failed: %s\n", res.msg);
         }
-        return true;
-    });
+    }
 }
 
 bool CChainState::FlushStateToDisk(
@@ -3437,11 +3536,22 @@ bool CChainState::FlushStateToDisk(
                 return AbortNode(state, "Failed to write to coin or masternode db to disk");
             }
             if (!compactBegin.empty() && !compactEnd.empty()) {
-                auto time = GetTimeMillis();
-                pcustomcsDB->Compact(compactBegin, compactEnd);
+                if (nCustomUndoDepth) {
+                    boost::unique_lock<boost::mutex> lock(cs_undoCompaction);
+                    if (undoCompactBegin.empty() || compactBegin < undoCompactBegin) {
+                        undoCompactBegin = compactBegin;
+                    }
+                    if (undoCompactEnd.empty() || compactEnd > undoCompactEnd) {
+                        undoCompactEnd = compactEnd;
+                    }
+                    cvUndoCompaction.notify_one();
+                } else {
+                    auto time = GetTimeMillis();
+                    pcustomcsDB->Compact(compactBegin, compactEnd);
+                    LogPrint(BCLog::BENCH, "    - DB compacting takes: %dms\n", GetTimeMillis() - time);
+                }
                 compactBegin.clear();
                 compactEnd.clear();
-                LogPrint(BCLog::BENCH, "    - DB compacting takes: %dms\n", GetTimeMillis() - time);
             }
             nLastFlush = nNow;
             full_flush_completed = true;
@@ -3592,6 +3702,10 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
             m_disconnectTip = false;
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         }
+        mempool.resetAccountsFootprints();
+        if (paccountHistoryDB && paccountHistoryDB->HasRewardHistory()) {
+            EraseBlockRewardHistory(*paccountHistoryDB, mnview.GetStorage().GetRaw(), pindexDelete->nHeight);
+        }
         bool flushed = view.Flush() && mnview.Flush();
         assert(flushed);
 
@@ -3739,6 +3853,7 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    std::set<TBytes> changedKeys;
     {
         CCoinsViewCache view(&CoinsTip());
         CCustomCSView mnview(*pcustomcsview.get());
@@ -3763,6 +3878,13 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
         }
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
+        // block changes under the mempool accounts view
+        for (const auto& it : mnview.GetStorage().GetRaw()) {
+            changedKeys.emplace(it.first.begin(), it.first.end());
+        }
+        if (paccountHistoryDB && paccountHistoryDB->HasRewardHistory()) {
+            WriteBlockRewardHistory(*paccountHistoryDB, *pcustomcsview, mnview.GetStorage().GetRaw(), pindexNew->nHeight);
+        }
         bool flushed = view.Flush() && mnview.Flush();
         assert(flushed);
 
@@ -3793,7 +3915,7 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
     LogPrint(BCLog::BENCH, "  - Writing chainstate: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime5 - nTime4) * MILLI, nTimeChainState * MICRO, nTimeChainState * MILLI / nBlocksTotal);
     // Remove conflicting transactions from the mempool.;
-    mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
+    mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight, &changedKeys);
     disconnectpool.removeForBlock(blockConnecting.vtx);
     // Update m_chain & related variables.
     m_chain.SetTip(pindexNew);
@@ -3803,6 +3925,7 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     if (pindexNew->nHeight >= Params().GetConsensus().DakotaHeight &&
             pindexNew->nHeight % Params().GetConsensus().mn.anchoringTeamChange == 0) {
         pcustomcsview->CalcAnchoringTeams(blockConnecting.stakeModifier, pindexNew);
+        mempool.resetAccountsFootprints();
 
         // Delete old and now invalid anchor confirms
         panchorAwaitingConfirms->Clear();